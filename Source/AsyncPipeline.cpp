@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    AsyncPipeline.cpp
+
+  ==============================================================================
+*/
+
+#include "AsyncPipeline.h"
+
+//==============================================================================
+AsyncPipeline::AsyncPipeline(ProcessFunction processFunction)
+    : juce::Thread("ChaorusFlangos pipeline"),
+      mProcessFunction(std::move(processFunction))
+{
+}
+
+AsyncPipeline::~AsyncPipeline()
+{
+    release();
+}
+
+void AsyncPipeline::prepare(int numChannels, int maxBlockSize)
+{
+    release();
+
+    mNumChannels = numChannels;
+    mMaxBlockSize = juce::jmax(1, maxBlockSize);
+    mLatencySamples = mMaxBlockSize;
+
+    /* Room for a few blocks, one of them is always the latency. The FIFOs keep one slot free. */
+    const int capacity = 4 * mMaxBlockSize + 1;
+
+    mInputQueue.setSize(mNumChannels, capacity);
+    mOutputQueue.setSize(mNumChannels, capacity);
+    mScratch.setSize(mNumChannels, mMaxBlockSize);
+    mDryLine.setSize(mNumChannels, mLatencySamples + mMaxBlockSize);
+    mDryLine.clear();
+    mDryPosition = 0;
+    mSamplesLate = 0;
+
+    mInputFifo.setTotalSize(capacity);
+    mBlockFifo.setTotalSize(capacity);
+    mBlocks.resize((size_t) capacity);
+    mOutputFifo.setTotalSize(capacity);
+
+    /* The first block out is silence, which is the block of latency */
+    mOutputQueue.clear();
+    mOutputFifo.finishedWrite(mLatencySamples);
+
+    mMissedDeadlines = 0;
+    mActive = true;
+
+    startThread(juce::Thread::Priority::highest);
+}
+
+void AsyncPipeline::release()
+{
+    if (mActive) {
+        signalThreadShouldExit();
+        mWorkQueued.signal();
+        stopThread(1000);
+        mActive = false;
+    }
+
+    mInputFifo.reset();
+    mBlockFifo.reset();
+    mOutputFifo.reset();
+}
+
+bool AsyncPipeline::isActive() const
+{
+    return mActive;
+}
+
+int AsyncPipeline::getLatencySamples() const
+{
+    return mActive ? mLatencySamples : 0;
+}
+
+int AsyncPipeline::getNumMissedDeadlines() const
+{
+    return mMissedDeadlines;
+}
+
+//==============================================================================
+template <typename SampleType>
+void AsyncPipeline::process(juce::AudioBuffer<SampleType>& buffer, juce::Optional<juce::int64> timelinePosition)
+{
+    const int numChannels = juce::jmin(mNumChannels, buffer.getNumChannels());
+    const int totalSamples = buffer.getNumSamples();
+
+    /* Hosts may go over the block size they prepared with, so take the buffer a block at a time */
+    for (int start = 0; start < totalSamples; start += mMaxBlockSize) {
+        const int numSamples = juce::jmin(mMaxBlockSize, totalSamples - start);
+        int start1, size1, start2, size2;
+
+        /* Keep the input for a dry fallback, one block of latency behind like the output */
+        for (int channel = 0; channel < numChannels; channel++) {
+            const SampleType* source = buffer.getReadPointer(channel, start);
+            double* dry = mDryLine.getWritePointer(channel);
+
+            for (int i = 0; i < numSamples; i++) {
+                dry[(mDryPosition + i) % mDryLine.getNumSamples()] = source[i];
+            }
+        }
+
+        /* Queue the input. The queue only fills up when the worker has stalled for blocks on end,
+           and then the block is dropped along with a block of the output already played dry. */
+        if (mInputFifo.getFreeSpace() >= numSamples) {
+            mInputFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                const SampleType* source = buffer.getReadPointer(channel, start);
+                double* queue = mInputQueue.getWritePointer(channel);
+
+                for (int i = 0; i < size1; i++) {
+                    queue[start1 + i] = source[i];
+                }
+
+                for (int i = 0; i < size2; i++) {
+                    queue[start2 + i] = source[size1 + i];
+                }
+            }
+
+            mInputFifo.finishedWrite(size1 + size2);
+
+            /* The block's place on the timeline travels with it, the input queue always has
+               room for at least as many blocks as samples */
+            mBlockFifo.prepareToWrite(1, start1, size1, start2, size2);
+            QueuedBlock& block = mBlocks[(size_t) start1];
+            block.numSamples = numSamples;
+            block.timelinePosition = timelinePosition;
+
+            if (timelinePosition) {
+                block.timelinePosition = *timelinePosition + start;
+            }
+
+            mBlockFifo.finishedWrite(1);
+
+            mWorkQueued.signal();
+        } else {
+            mSamplesLate = juce::jmax(0, mSamplesLate - numSamples);
+        }
+
+        /* The worker missed its deadline. Finish the queued input here if it isn't in the middle
+           of a block, but never wait for it. */
+        if (mOutputFifo.getNumReady() < mSamplesLate + numSamples) {
+            mMissedDeadlines++;
+
+            while (mOutputFifo.getNumReady() < mSamplesLate + numSamples) {
+                if (!processQueued()) {
+                    break;
+                }
+            }
+        }
+
+        /* Output for blocks that already went out dry is out of date, drop it */
+        if (mSamplesLate > 0) {
+            mOutputFifo.prepareToRead(mSamplesLate, start1, size1, start2, size2);
+            mOutputFifo.finishedRead(size1 + size2);
+            mSamplesLate -= size1 + size2;
+        }
+
+        const int numReady = juce::jmin(numSamples, mOutputFifo.getNumReady());
+
+        mOutputFifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            const double* queue = mOutputQueue.getReadPointer(channel);
+            SampleType* destination = buffer.getWritePointer(channel, start);
+
+            for (int i = 0; i < size1; i++) {
+                destination[i] = (SampleType) queue[start1 + i];
+            }
+
+            for (int i = 0; i < size2; i++) {
+                destination[size1 + i] = (SampleType) queue[start2 + i];
+            }
+        }
+
+        mOutputFifo.finishedRead(size1 + size2);
+
+        /* Whatever still isn't ready goes out dry, and its output is dropped when it turns up */
+        if (numReady < numSamples) {
+            for (int channel = 0; channel < numChannels; channel++) {
+                const double* dry = mDryLine.getReadPointer(channel);
+                SampleType* destination = buffer.getWritePointer(channel, start);
+
+                for (int i = numReady; i < numSamples; i++) {
+                    destination[i] = (SampleType) dry[(mDryPosition + i + mDryLine.getNumSamples() - mLatencySamples) % mDryLine.getNumSamples()];
+                }
+            }
+
+            mSamplesLate += numSamples - numReady;
+        }
+
+        mDryPosition = (mDryPosition + numSamples) % mDryLine.getNumSamples();
+    }
+}
+
+template void AsyncPipeline::process<float>(juce::AudioBuffer<float>&, juce::Optional<juce::int64>);
+template void AsyncPipeline::process<double>(juce::AudioBuffer<double>&, juce::Optional<juce::int64>);
+
+//==============================================================================
+void AsyncPipeline::run()
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    while (!threadShouldExit()) {
+        /* process() signals when it queues a block, the timeout is only a backstop */
+        if (!processQueued()) {
+            mWorkQueued.wait(100);
+        }
+    }
+}
+
+bool AsyncPipeline::processQueued()
+{
+    bool expected = false;
+    if (!mDSPBusy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        return false;
+    }
+
+    /* One queued block at a time, once there is room for its output */
+    int numSamples = 0;
+
+    if (mBlockFifo.getNumReady() > 0) {
+        int start1, size1, start2, size2;
+
+        mBlockFifo.prepareToRead(1, start1, size1, start2, size2);
+        const QueuedBlock block = mBlocks[(size_t) start1];
+
+        if (mOutputFifo.getFreeSpace() >= block.numSamples) {
+            numSamples = block.numSamples;
+
+            mInputFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+            for (int channel = 0; channel < mNumChannels; channel++) {
+                mScratch.copyFrom(channel, 0, mInputQueue, channel, start1, size1);
+                if (size2 > 0) {
+                    mScratch.copyFrom(channel, size1, mInputQueue, channel, start2, size2);
+                }
+            }
+            mInputFifo.finishedRead(size1 + size2);
+            mBlockFifo.finishedRead(1);
+
+            mProcessFunction(mScratch.getArrayOfWritePointers(), mNumChannels, numSamples, block.timelinePosition);
+
+            mOutputFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+            for (int channel = 0; channel < mNumChannels; channel++) {
+                mOutputQueue.copyFrom(channel, start1, mScratch, channel, 0, size1);
+                if (size2 > 0) {
+                    mOutputQueue.copyFrom(channel, start2, mScratch, channel, size1, size2);
+                }
+            }
+            mOutputFifo.finishedWrite(size1 + size2);
+        }
+    }
+
+    mDSPBusy.store(false, std::memory_order_release);
+    return numSamples > 0;
+}
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    AsyncPipeline.h
+
+    Optional pipelined processing. The DSP runs on a worker thread one host
+    block behind: the audio callback only queues its input and takes back the
+    output of the block before, through lock-free FIFOs, and the block of
+    delay is reported to the host as latency. When the worker falls behind
+    and the output isn't ready in time, the audio thread finishes the queued
+    work itself if the worker isn't in the middle of a block, and otherwise
+    plays the input dry for what's missing. It never waits for the worker.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "WakeSignal.h"
+
+class AsyncPipeline : private juce::Thread
+{
+public:
+    /* Processes numSamples of numChannels channels in place, given where the first of them
+       sits on the host's timeline if that is known */
+    using ProcessFunction = std::function<void(double* const* channels, int numChannels, int numSamples,
+                                               juce::Optional<juce::int64> timelinePosition)>;
+
+    explicit AsyncPipeline(ProcessFunction processFunction);
+    ~AsyncPipeline() override;
+
+    /* Allocates the queues, primes the output with one block of silence and starts the worker */
+    void prepare(int numChannels, int maxBlockSize);
+
+    /* Stops the worker and drops anything queued */
+    void release();
+
+    bool isActive() const;
+
+    /* Delay the pipeline adds, 0 when it isn't running */
+    int getLatencySamples() const;
+
+    /* Blocks whose output wasn't ready in time since prepare() */
+    int getNumMissedDeadlines() const;
+
+    /* Audio thread only: queues the buffer's contents for the worker and replaces them
+       with the output of one block earlier. The timeline position goes through the queue
+       with the block and reaches the process function along with it. */
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, juce::Optional<juce::int64> timelinePosition);
+
+private:
+    void run() override;
+
+    /* Runs the DSP over the oldest queued block, unless the other thread already is.
+       Returns true if it processed anything. */
+    bool processQueued();
+
+    ProcessFunction mProcessFunction;
+
+    int mNumChannels = 0;
+    int mMaxBlockSize = 0;
+    int mLatencySamples = 0;
+    bool mActive = false;
+
+    /* Input from the audio thread to the DSP, and output back. Stored in double so float
+       and double precision hosts go through the same queues without losing anything. */
+    juce::AbstractFifo mInputFifo { 1 };
+    juce::AbstractFifo mOutputFifo { 1 };
+    juce::AudioBuffer<double> mInputQueue;
+    juce::AudioBuffer<double> mOutputQueue;
+    juce::AudioBuffer<double> mScratch;
+
+    /* The blocks in the input queue, in order */
+    struct QueuedBlock
+    {
+        int numSamples = 0;
+        juce::Optional<juce::int64> timelinePosition;
+    };
+
+    juce::AbstractFifo mBlockFifo { 1 };
+    std::vector<QueuedBlock> mBlocks;
+
+    /* Audio thread only: the input one block of latency back, played when the output
+       isn't ready, and how much output still to come was replaced by it */
+    juce::AudioBuffer<double> mDryLine;
+    int mDryPosition = 0;
+    int mSamplesLate = 0;
+
+    /* Whoever sets this owns the DSP: it alone reads the input queue, runs the process
+       function and writes the output queue until it clears it again */
+    std::atomic<bool> mDSPBusy { false };
+    std::atomic<int> mMissedDeadlines { 0 };
+
+    /* Wakes the worker when a block is queued */
+    WakeSignal mWorkQueued;
+
+    JUCE_DECLARE_NON_COPYABLE(AsyncPipeline)
+};
@@ -0,0 +1,371 @@
+/*
+  ==============================================================================
+
+    ChaorusBatch.h
+
+    The effect on 4, 8 or 16 independent mono streams in lockstep, for
+    servers that run it on many stems at once. Each lane has its own
+    parameters, LFOs and feedback. The delay lines of all the lanes are
+    interleaved frame by frame in one buffer, so each sample's writes,
+    reads and mixing are one run across the lanes, a vector wide at the
+    lane count getPreferredBatchLanes() picks.
+
+        auto batch = std::make_unique<chaorus::BatchState>();
+        auto delayMemory = chaorus::makeDelayMemory (chaorus::getBatchBufferSize (48000.0, 8));
+        chaorus::prepareBatch (*batch, 8, 48000.0, delayMemory.get());
+
+        chaorus::submit (*batch, lane, parameters, in, out);   // for each stream
+        chaorus::flush (*batch, numFrames);
+
+    Every lane puts out exactly what a single State prepared at the same
+    time puts out on the left channel for the same mono input. Lanes run at
+    full quality and the full sample rate. A lane that isn't submitted
+    before a flush is fed silence and its output is dropped, so it stays on
+    the batch's grid.
+
+    Header-only and free of JUCE, like the rest of the DSP core.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ChaorusCore.h"
+
+namespace chaorus
+{
+
+constexpr int maxBatchLanes = 16;
+
+/* Lanes that fill a vector register at the kernel level in use */
+inline int getPreferredBatchLanes()
+{
+    switch (getPreferredKernelLevel()) {
+        case KernelLevel::AVX512:   return 16;
+        case KernelLevel::AVX2:     return 8;
+        case KernelLevel::Baseline: break;
+    }
+
+    return 4;
+}
+
+/* Everything a batch carries from one flush() to the next. It is large, allocate it on the heap. */
+struct BatchState
+{
+    int numLanes = 4;
+
+    /* Each lane's parameter smoothing and LFOs run on a State of its own, which has no delay
+       memory, through the same control-rate code as a single instance */
+    State lanes[maxBatchLanes];
+
+    /* numLanes mono delay lines interleaved frame by frame, plus one guard frame at the end that
+       mirrors frame 0. Owned by the caller. */
+    float* circularBuffer = nullptr;
+    int circularBufferLength = 0;
+    int writeHead = 0;
+
+    float feedback[maxBatchLanes] = {};
+
+    /* Samples into the current quantum, and what its start worked out for every lane: the delay
+       times, frame by frame, for the main engine and Dual mode's flanger, and the gains */
+    int quantumPosition = 0;
+    int quantumMaxChunkLength = 1;
+    float quantumDelays[processingQuantum * maxBatchLanes] = {};
+    float quantumFlangerDelays[processingQuantum * maxBatchLanes] = {};
+    float quantumDryAmounts[maxBatchLanes] = {};
+    float quantumWetAmounts[maxBatchLanes] = {};
+    float quantumFeedback[maxBatchLanes] = {};
+    float quantumDistortion[maxBatchLanes] = {};    // 0 for lanes that don't saturate
+    bool quantumAnyDual = false;
+    bool quantumAnySerial = false;
+    bool quantumAnyDistortion = false;
+
+    /* What submit() has queued for the next flush() */
+    Parameters parameters[maxBatchLanes];
+    const float* input[maxBatchLanes] = {};
+    float* output[maxBatchLanes] = {};
+
+    const DSPKernels* kernels = &getDSPKernels (getPreferredKernelLevel());
+};
+
+/* Number of floats of delay memory prepareBatch() needs for delays up to delayTime seconds, see
+   getCircularBufferSize() */
+inline size_t getBatchBufferSize (double sampleRate, int numLanes, double delayTime = maxDelayTime)
+{
+    return ((size_t) getCircularBufferLength (sampleRate, delayTime) + 1) * (size_t) numLanes;
+}
+
+/* Clears every lane's delay line and restarts its LFOs, and drops anything submitted */
+inline void resetBatch (BatchState& batch)
+{
+    if (batch.circularBuffer != nullptr) {
+        std::memset (batch.circularBuffer, 0, ((size_t) batch.circularBufferLength + 1) * (size_t) batch.numLanes * sizeof (float));
+    }
+
+    batch.writeHead = 0;
+    batch.quantumPosition = 0;
+
+    for (int lane = 0; lane < maxBatchLanes; lane++) {
+        reset (batch.lanes[lane]);
+        batch.feedback[lane] = 0;
+        batch.input[lane] = nullptr;
+        batch.output[lane] = nullptr;
+    }
+}
+
+/* Points the batch at getBatchBufferSize (sampleRate, numLanes, delayTime) floats of caller-owned
+   memory, best from allocateDelayMemory(), and resets it. numLanes is 4, 8 or 16. */
+inline void prepareBatch (BatchState& batch, int numLanes, double sampleRate, float* circularBuffer,
+                          double delayTime = maxDelayTime)
+{
+    batch.numLanes = numLanes >= 16 ? 16 : (numLanes >= 8 ? 8 : 4);
+
+    for (int lane = 0; lane < maxBatchLanes; lane++) {
+        prepare (batch.lanes[lane], sampleRate, nullptr, false, delayTime);
+    }
+
+    batch.circularBuffer = circularBuffer;
+    batch.circularBufferLength = batch.lanes[0].circularBufferLength;
+
+    resetBatch (batch);
+}
+
+/* Queues a lane's next frames of mono input and where its output goes, for the next flush().
+   input and output may be the same buffer. */
+inline void submit (BatchState& batch, int lane, const Parameters& parameters, const float* input, float* output)
+{
+    if (lane < 0 || lane >= batch.numLanes) {
+        return;
+    }
+
+    batch.parameters[lane] = parameters;
+    batch.input[lane] = input;
+    batch.output[lane] = output;
+}
+
+//==============================================================================
+namespace detail
+{
+    /* beginQuantum for every lane, and the delay times and gains laid out across the lanes */
+    inline void beginBatchQuantum (BatchState& batch)
+    {
+        const int numLanes = batch.numLanes;
+
+        batch.quantumMaxChunkLength = processingQuantum;
+        batch.quantumAnyDual = false;
+        batch.quantumAnySerial = false;
+        batch.quantumAnyDistortion = false;
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            State& state = batch.lanes[lane];
+            state.kernels = batch.kernels;
+
+            beginQuantum (state, batch.parameters[lane]);
+
+            const Parameters& current = state.quantumParameters;
+            const bool dual = current.type == Dual;
+
+            /* Every lane's chunks are as short as the shortest, which keeps each lane's reads
+               clear of its own writes just the same */
+            batch.quantumMaxChunkLength = std::min (batch.quantumMaxChunkLength, state.quantumMaxChunkLength);
+
+            batch.quantumWetAmounts[lane] = dual ? 1.0f : current.dryWet;
+            batch.quantumDryAmounts[lane] = dual ? getDualDryAmount (current) : 1 - current.dryWet;
+            batch.quantumFeedback[lane] = current.feedback;
+            batch.quantumDistortion[lane] = current.type == Tormentrix && current.distortion > 0.0f ? current.distortion : 0.0f;
+
+            batch.quantumAnyDual = batch.quantumAnyDual || dual;
+            batch.quantumAnySerial = batch.quantumAnySerial || (dual && current.routing == Serial);
+            batch.quantumAnyDistortion = batch.quantumAnyDistortion || batch.quantumDistortion[lane] > 0.0f;
+        }
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            const State& state = batch.lanes[lane];
+
+            for (int i = 0; i < processingQuantum; i++) {
+                batch.quantumDelays[i * numLanes + lane] = state.quantumDelayLeft[i];
+            }
+
+            /* Once any lane runs a flanger every lane reads one, those without at the main delays */
+            if (batch.quantumAnyDual) {
+                const float* flangerDelays = state.quantumParameters.type == Dual ? state.quantumFlangerDelayLeft : state.quantumDelayLeft;
+
+                for (int i = 0; i < processingQuantum; i++) {
+                    batch.quantumFlangerDelays[i * numLanes + lane] = flangerDelays[i];
+                }
+            }
+        }
+    }
+
+    /* combineEngines for the Dual lanes, in place: the chorus reads become the wet signal and
+       loop gets what is fed back. Other lanes feed back their reads as they are. */
+    inline void combineBatchEngines (const BatchState& batch, float* taps, const float* flangerTaps, const float* serialTaps,
+                                     float* loop, int numSamples)
+    {
+        const int numLanes = batch.numLanes;
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            const Parameters& current = batch.lanes[lane].quantumParameters;
+
+            if (current.type != Dual) {
+                for (int i = 0; i < numSamples; i++) {
+                    loop[i * numLanes + lane] = taps[i * numLanes + lane];
+                }
+                continue;
+            }
+
+            const float chorusMix = current.dryWet;
+            const float flangerMix = current.flangerMix;
+
+            if (current.routing == Serial) {
+                const float chorusAmount = chorusMix * (1 - flangerMix);
+                const float flangerAmount = (1 - chorusMix) * flangerMix;
+                const float serialAmount = chorusMix * flangerMix;
+
+                for (int i = 0; i < numSamples; i++) {
+                    const int k = i * numLanes + lane;
+                    loop[k] = serialTaps[k];
+                    taps[k] = taps[k] * chorusAmount + flangerTaps[k] * flangerAmount + serialTaps[k] * serialAmount;
+                }
+            } else {
+                for (int i = 0; i < numSamples; i++) {
+                    const int k = i * numLanes + lane;
+                    loop[k] = 0.5f * (taps[k] + flangerTaps[k]);
+                    taps[k] = 0.5f * (taps[k] * chorusMix + flangerTaps[k] * flangerMix);
+                }
+            }
+        }
+    }
+}
+
+/* Runs frames samples of every lane, from what was submitted since the last flush */
+inline void flush (BatchState& batch, int frames)
+{
+    if (frames <= 0 || batch.circularBuffer == nullptr) {
+        return;
+    }
+
+    ScopedRealtimeSection realtimeSection;
+
+    const DSPKernels& kernels = *batch.kernels;
+    const int numLanes = batch.numLanes;
+
+    /* The chunk's samples of every lane, frame by frame */
+    float input[processingQuantum * maxBatchLanes];
+    float taps[processingQuantum * maxBatchLanes];
+    float flangerTaps[processingQuantum * maxBatchLanes];
+    float serialTaps[processingQuantum * maxBatchLanes];
+    float serialDelays[processingQuantum * maxBatchLanes];
+    float loopBuffer[processingQuantum * maxBatchLanes];
+
+    for (int start = 0; start < frames;) {
+        if (batch.quantumPosition == 0) {
+            detail::beginBatchQuantum (batch);
+        }
+
+        /* Chunks never cross a quantum boundary or wrap around the end of the circular buffer */
+        const int chunkLength = std::min ({ batch.quantumMaxChunkLength, processingQuantum - batch.quantumPosition,
+                                            frames - start, batch.circularBufferLength - batch.writeHead });
+        const int numValues = chunkLength * numLanes;
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            const float* laneInput = batch.input[lane];
+
+            for (int i = 0; i < chunkLength; i++) {
+                input[i * numLanes + lane] = laneInput != nullptr ? laneInput[start + i] : 0.0f;
+            }
+        }
+
+        float* frame = batch.circularBuffer + numLanes * batch.writeHead;
+
+        /* Write the first frame before reading, the shortest delays can reach it */
+        for (int lane = 0; lane < numLanes; lane++) {
+            frame[lane] = input[lane] + batch.feedback[lane];
+        }
+
+        /* Chunks never wrap, so frame 0 is only ever written here. Keep the guard frame in sync. */
+        if (batch.writeHead == 0) {
+            std::memcpy (batch.circularBuffer + numLanes * batch.circularBufferLength, frame, (size_t) numLanes * sizeof (float));
+        }
+
+        const int position = batch.quantumPosition;
+
+        kernels.delayReadLanes (batch.circularBuffer, batch.circularBufferLength, batch.writeHead, numLanes,
+                                batch.quantumDelays + position * numLanes, taps, chunkLength);
+
+        const float* loop = taps;
+
+        if (batch.quantumAnyDual) {
+            const float* flangerDelays = batch.quantumFlangerDelays + position * numLanes;
+
+            kernels.delayReadLanes (batch.circularBuffer, batch.circularBufferLength, batch.writeHead, numLanes,
+                                    flangerDelays, flangerTaps, chunkLength);
+
+            /* The serial tap, as readTaps works it out */
+            if (batch.quantumAnySerial) {
+                const float* delays = batch.quantumDelays + position * numLanes;
+
+                for (int k = 0; k < numValues; k++) {
+                    serialDelays[k] = delays[k] + flangerDelays[k];
+                }
+
+                kernels.delayReadLanes (batch.circularBuffer, batch.circularBufferLength, batch.writeHead, numLanes,
+                                        serialDelays, serialTaps, chunkLength);
+            }
+
+            detail::combineBatchEngines (batch, taps, flangerTaps, serialTaps, loopBuffer, chunkLength);
+            loop = loopBuffer;
+        }
+
+        /* Write the rest of the chunk, each frame carrying the feedback of the previous read. The
+           gains are copied out of the batch first, the writes to the buffer can't alias a local. */
+        float feedback[maxBatchLanes];
+        std::memcpy (feedback, batch.quantumFeedback, sizeof (feedback));
+
+        for (int i = 1; i < chunkLength; i++) {
+            for (int lane = 0; lane < numLanes; lane++) {
+                frame[i * numLanes + lane] = input[i * numLanes + lane] + loop[(i - 1) * numLanes + lane] * feedback[lane];
+            }
+        }
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            batch.feedback[lane] = loop[(chunkLength - 1) * numLanes + lane] * feedback[lane];
+        }
+
+        if (batch.quantumAnyDistortion) {
+            kernels.saturateLanes (taps, chunkLength, numLanes, batch.quantumDistortion);
+        }
+
+        kernels.mixLanes (input, taps, input, chunkLength, numLanes, batch.quantumDryAmounts, batch.quantumWetAmounts);
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            if (float* laneOutput = batch.output[lane]) {
+                for (int i = 0; i < chunkLength; i++) {
+                    laneOutput[start + i] = input[i * numLanes + lane];
+                }
+            }
+        }
+
+        batch.writeHead += chunkLength;
+
+        if (batch.writeHead >= batch.circularBufferLength) {
+            batch.writeHead = 0;
+        }
+
+        batch.quantumPosition += chunkLength;
+
+        if (batch.quantumPosition == processingQuantum) {
+            batch.quantumPosition = 0;
+        }
+
+        start += chunkLength;
+    }
+
+    /* Each flush takes a new round of submissions */
+    for (int lane = 0; lane < numLanes; lane++) {
+        batch.input[lane] = nullptr;
+        batch.output[lane] = nullptr;
+    }
+}
+
+} // namespace chaorus
@@ -0,0 +1,1240 @@
+/*
+  ==============================================================================
+
+    ChaorusCore.h
+
+    The ChaorusFlangos effect as a standalone, header-only C++ library with
+    no JUCE dependency. All state lives in a caller-owned State, including
+    the delay memory, so the effect can be embedded in any audio engine.
+    The plugin's processor is a thin adapter over this.
+
+        chaorus::State state;
+        auto delayMemory = chaorus::makeDelayMemory (chaorus::getCircularBufferSize (48000.0));
+        chaorus::prepare (state, 48000.0, delayMemory.get());
+
+        chaorus::Parameters parameters;
+        chaorus::process (state, parameters, in, out, 2, numFrames);
+
+    Optional quality tiers trade accuracy of the wet path for CPU, see
+    Quality and QualityGovernor.h.
+
+    process() works on float or double buffers. The delay lines are always
+    float whatever the I/O precision, so double precision hosts don't pay
+    twice the delay memory. process() doesn't allocate, lock or touch
+    denormal modes; callers that care about denormals should enable
+    flush-to-zero around it.
+
+    At high sample rates the wet path can run decimated to a 44.1/48 kHz
+    class rate while the dry signal stays at the full rate, see prepare().
+
+    The delay memory only has to hold the delay range in use, see
+    getDelayMemoryTime(), and can be swapped for more while processing runs,
+    with the copying done on another thread, see DelayMemoryGrowth.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DSPKernels.h"
+#include "Multirate.h"
+#include "RealtimeSafety.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace chaorus
+{
+
+/* Version of the rendered output. Bump it with any change that alters what process()
+   produces for the same input and parameters, it invalidates cached renders. */
+constexpr int engineVersion = 4;
+
+/* Longest base delay and sweep above it a custom delay range can have, in seconds */
+constexpr float maxBaseDelay = 3.0f;
+constexpr float maxDelayRange = 3.0f;
+
+/* Longest delay any setting reaches, in seconds: the longest custom range, plus the flanger
+   delay Dual mode's serial tap adds on top of it */
+constexpr double maxDelayTime = maxBaseDelay + maxDelayRange + 0.005;
+
+/* Processing runs on a fixed grid of quanta of this many samples, whatever the host's block
+   size. Control-rate work (parameter smoothing, the LFOs) happens once at the start of each
+   quantum, and no run of samples handed to the kernels is longer than a quantum. */
+constexpr int processingQuantum = 64;
+
+/* Time constant of the parameter smoothing, in seconds */
+constexpr double parameterSmoothingTime = 0.02;
+
+enum Type
+{
+    Jello = 0,      // chorus
+    Wavy,           // flanger
+    Tormentrix,     // flanger with distortion
+    Dual            // chorus and flanger together on one delay line
+};
+
+/* How Dual mode chains its two engines */
+enum Routing
+{
+    Parallel = 0,   // chorus and flanger side by side, averaged
+    Serial          // chorus into flanger
+};
+
+struct Parameters
+{
+    float dryWet = 0.5f;
+    float depth = 0.5f;
+    float rate = 10.0f;         // LFO rate in Hz
+    float phaseOffset = 0.0f;   // right channel LFO phase offset, in cycles
+    float feedback = 0.5f;
+    float distortion = 0.0f;    // Tormentrix only
+    int type = Jello;
+    int shape = Sine;           // LFOShape
+
+    /* Dual only. The chorus engine takes depth, rate and dryWet above as its depth, rate and
+       mix, and the flanger engine these. Both share the phase offset, feedback and shape. */
+    float flangerDepth = 0.5f;
+    float flangerRate = 0.5f;   // Hz
+    float flangerMix = 0.5f;
+    int routing = Parallel;
+
+    /* A delay range of its own instead of the type's, in seconds, reaching out to doubling and
+       slapback delays: the shortest delay and how far above it the LFO sweeps. Only used while
+       baseDelay > 0. In Dual mode the chorus engine takes it and the flanger keeps its own. */
+    float baseDelay = 0.0f;
+    float delayRange = 0.0f;
+};
+
+/* How a delay line is read between frames */
+enum class Interpolation
+{
+    Linear = 0,
+    Nearest
+};
+
+/* How Tormentrix shapes the wet signal */
+enum class Saturation
+{
+    Tanh = 0,
+    Rational        // Pade approximant of tanh, no transcendental call
+};
+
+/* Processing quality of the wet path. Cheaper settings never change the delay
+   line contents beyond what their own reads feed back. */
+struct Quality
+{
+    int controlInterval = 1;    // samples between LFO evaluations, delay times ramp linearly in between
+    Interpolation interpolation = Interpolation::Linear;
+    Saturation saturation = Saturation::Tanh;
+};
+
+inline bool operator== (const Quality& a, const Quality& b)
+{
+    return a.controlInterval == b.controlInterval && a.interpolation == b.interpolation && a.saturation == b.saturation;
+}
+
+inline bool operator!= (const Quality& a, const Quality& b)
+{
+    return !(a == b);
+}
+
+/* Quality tiers from full quality down, the cheapest last */
+constexpr Quality qualityTiers[] = {
+    { 1, Interpolation::Linear, Saturation::Tanh },
+    { 8, Interpolation::Linear, Saturation::Rational },
+    { 32, Interpolation::Nearest, Saturation::Rational }
+};
+
+constexpr int numQualityTiers = (int) (sizeof (qualityTiers) / sizeof (qualityTiers[0]));
+
+/* Samples a quality change is crossfaded over, a whole number of quanta */
+constexpr int qualityFadeLength = 8 * processingQuantum;
+
+/* Where an LFO is. Its phase at the start of the next quantum is worked out in double from the
+   samples since an origin rather than added up quantum by quantum, so it never drifts and comes
+   out the same however that position was reached. A rate change moves the origin to where the
+   change happens. */
+struct LFOState
+{
+    double originPhase = 0;
+    float rate = 0;             // Hz
+    int64_t position = 0;       // samples at the full rate from the origin to the start of the next quantum
+};
+
+inline double getLFOPhase (const LFOState& lfo, double sampleRate)
+{
+    double cycles = lfo.originPhase + lfo.position * ((double) lfo.rate / sampleRate);
+    return cycles - std::floor (cycles);
+}
+
+/* Everything one instance of the effect carries from one process() call to the next */
+struct State
+{
+    double sampleRate = 44100.0;
+
+    /* With multirate processing the wet path runs decimated by decimation, at engineSampleRate.
+       Otherwise decimation is 1 and it runs at the sample rate. */
+    int decimation = 1;
+    double engineSampleRate = 44100.0;
+    double lfoLag = 0;              // in engine samples
+    MultirateState multirate;
+
+    /* Interleaved [L, R] frames plus one guard frame at the end that mirrors frame 0, so
+       both channels of a frame share one 64-bit access and the two taps of a read share
+       one [L, R, L, R] quad. Owned by the caller. */
+    float* circularBuffer = nullptr;
+    int circularBufferLength = 0;
+    int writeHead = 0;
+    int64_t framesWritten = 0;      // since the last reset, for growing the memory as it runs
+
+    /* The flanger LFO only runs in Dual mode */
+    LFOState lfo;
+    LFOState flangerLfo;
+
+    float feedbackLeft = 0;
+    float feedbackRight = 0;
+
+    /* Quality the wet path runs at and, while qualityFadeRemaining > 0, the one it is fading
+       away from. setQuality() asks for targetQuality, which starts on a quantum boundary. */
+    Quality quality;
+    Quality previousQuality;
+    Quality targetQuality;
+    int qualityFadeRemaining = 0;
+
+    /* Samples into the current quantum, and what its start worked out for the whole of it:
+       the parameters it runs with, smoothed towards the latest ones passed to process(), the
+       delay times at the current quality and, while fading, at the previous one, for the main
+       engine and Dual mode's flanger */
+    int quantumPosition = 0;
+    bool parametersSmoothed = false;
+    float smoothingCoefficient = 1.0f;
+    Parameters quantumParameters;
+    int quantumMaxChunkLength = 1;
+    float quantumDelayLeft[processingQuantum] = {};
+    float quantumDelayRight[processingQuantum] = {};
+    float quantumFadeDelayLeft[processingQuantum] = {};
+    float quantumFadeDelayRight[processingQuantum] = {};
+    float quantumFlangerDelayLeft[processingQuantum] = {};
+    float quantumFlangerDelayRight[processingQuantum] = {};
+    float quantumFadeFlangerDelayLeft[processingQuantum] = {};
+    float quantumFadeFlangerDelayRight[processingQuantum] = {};
+
+    const DSPKernels* kernels = &getDSPKernels (getPreferredKernelLevel());
+};
+
+//==============================================================================
+/* Modulated delay range in seconds for a type */
+inline void getDelayTimeRange (int type, float& minDelayTime, float& maxDelayTime)
+{
+    // chorus
+    if (type == Jello) {
+        minDelayTime = 0.005f;
+        maxDelayTime = 0.03f;
+
+    // both, the serial tap of Dual mode reaches the sum of the chorus and flanger delays
+    } else if (type == Dual) {
+        minDelayTime = 0.001f;
+        maxDelayTime = 0.035f;
+
+    // flanger, and tormentrix which is the same as flanger but with distortion
+    } else {
+        minDelayTime = 0.001f;
+        maxDelayTime = 0.005f;
+    }
+}
+
+/* Modulated delay range in seconds of a type, or of the parameters' own delay range if they have one */
+inline void getDelayTimeRange (const Parameters& parameters, int type, float& minDelayTime, float& maxDelayTime)
+{
+    getDelayTimeRange (type, minDelayTime, maxDelayTime);
+
+    if (parameters.baseDelay <= 0) {
+        return;
+    }
+
+    const float baseDelay = std::min (parameters.baseDelay, maxBaseDelay);
+    const float delayRange = std::min (std::max (parameters.delayRange, 0.0f), maxDelayRange);
+
+    /* Dual mode's serial tap still adds the flanger's delays, and its shortest delay is the flanger's if that is shorter */
+    if (type == Dual) {
+        float flangerMinDelayTime, flangerMaxDelayTime;
+        getDelayTimeRange (Wavy, flangerMinDelayTime, flangerMaxDelayTime);
+
+        minDelayTime = std::min (baseDelay, flangerMinDelayTime);
+        maxDelayTime = baseDelay + delayRange + flangerMaxDelayTime;
+    } else {
+        minDelayTime = baseDelay;
+        maxDelayTime = baseDelay + delayRange;
+    }
+}
+
+/* Longest delay the parameters reach in any mode, in seconds, which is what the delay memory has
+   to hold for them. Switching modes never needs more memory, only a longer delay range does. */
+inline double getDelayMemoryTime (const Parameters& parameters)
+{
+    float longestDelayTime = 0;
+
+    for (int type = Jello; type <= Dual; type++) {
+        float minDelayTime, maxDelayTime;
+        getDelayTimeRange (parameters, type, minDelayTime, maxDelayTime);
+
+        longestDelayTime = std::max (longestDelayTime, maxDelayTime);
+    }
+
+    return longestDelayTime;
+}
+
+/* Frames of delay line that hold delayTime seconds at an engine rate, with a few to spare so the
+   longest reads never reach the frame being written */
+inline int getCircularBufferLength (double engineSampleRate, double delayTime)
+{
+    return (int) std::ceil (engineSampleRate * delayTime) + 4;
+}
+
+/* Number of floats of delay memory prepare() needs at a sample rate for delays up to delayTime
+   seconds. getDelayMemoryTime() of the parameters to come allocates only what they need, the
+   default holds any setting. */
+inline size_t getCircularBufferSize (double sampleRate, bool multirate = false, double delayTime = maxDelayTime)
+{
+    if (multirate) {
+        sampleRate /= getDecimationFactor (sampleRate);
+    }
+
+    return ((size_t) getCircularBufferLength (sampleRate, delayTime) + 1) * 2;
+}
+
+/* Alignment of delay memory in bytes. A cache line, so a stereo frame is always one aligned
+   64-bit store that never splits across two lines, and a frame of the batched engine's lanes
+   starts on a vector boundary (a 16 lane frame is exactly one line). */
+constexpr size_t delayMemoryAlignment = 64;
+
+/* size floats of zeroed delay memory at delayMemoryAlignment, freed with freeDelayMemory().
+   Allocates, so not for the audio thread. */
+inline float* allocateDelayMemory (size_t size)
+{
+    float* memory = static_cast<float*> (::operator new[] (size * sizeof (float), std::align_val_t (delayMemoryAlignment)));
+    std::memset (memory, 0, size * sizeof (float));
+    return memory;
+}
+
+inline void freeDelayMemory (float* memory)
+{
+    if (memory != nullptr) {
+        ::operator delete[] (memory, std::align_val_t (delayMemoryAlignment));
+    }
+}
+
+struct DelayMemoryDeleter
+{
+    void operator() (float* memory) const { freeDelayMemory (memory); }
+};
+
+using DelayMemoryPtr = std::unique_ptr<float[], DelayMemoryDeleter>;
+
+/* allocateDelayMemory() for callers that keep the memory for as long as one object lives */
+inline DelayMemoryPtr makeDelayMemory (size_t size)
+{
+    return DelayMemoryPtr (allocateDelayMemory (size));
+}
+
+/* Clears the delay lines and restarts the LFO */
+inline void reset (State& state)
+{
+    if (state.circularBuffer != nullptr) {
+        std::memset (state.circularBuffer, 0, ((size_t) state.circularBufferLength + 1) * 2 * sizeof (float));
+    }
+
+    state.writeHead = 0;
+    state.framesWritten = 0;
+    state.lfo = LFOState();
+    state.flangerLfo = LFOState();
+    state.feedbackLeft = 0;
+    state.feedbackRight = 0;
+
+    state.previousQuality = state.quality;
+    state.targetQuality = state.quality;
+    state.qualityFadeRemaining = 0;
+
+    /* The first quantum jumps straight to the parameters instead of gliding from stale ones */
+    state.quantumPosition = 0;
+    state.parametersSmoothed = false;
+
+    resetMultirate (state.multirate, state.decimation);
+}
+
+/* Points the state at getCircularBufferSize (sampleRate, multirate, delayTime) floats of caller-owned
+   memory, best from allocateDelayMemory() so it starts at delayMemoryAlignment, and resets it. Longer delays than delayTime are held to it until setDelayMemory() brings
+   more memory. Multirate processing runs the wet path at the rate getDecimationFactor() brings
+   the sample rate down to, a fraction of the cost at 88.2 kHz and up, and brings the wet signal
+   back up to mix with the dry one. The wet signal keeps everything up to about 20 kHz, and the
+   output is getLatencySamples() late. */
+inline void prepare (State& state, double sampleRate, float* circularBuffer, bool multirate = false,
+                     double delayTime = maxDelayTime)
+{
+    state.sampleRate = sampleRate;
+    state.decimation = multirate ? getDecimationFactor (sampleRate) : 1;
+    state.engineSampleRate = sampleRate / state.decimation;
+    state.lfoLag = getMultirateLFOLag (state.decimation) / (double) state.decimation;
+
+    state.circularBuffer = circularBuffer;
+    state.circularBufferLength = getCircularBufferLength (state.engineSampleRate, delayTime);
+    state.smoothingCoefficient = (float) (1.0 - std::exp (-processingQuantum / (parameterSmoothingTime * state.engineSampleRate)));
+
+    reset (state);
+}
+
+/* Growing the delay memory of a state that is running. Most of the copying can happen away from
+   the audio thread: beginDelayMemoryGrowth() there notes where the history stands, then
+   copyDelayHistory() on any other thread copies it to the new memory while process() goes on, and
+   catchUpDelayHistory() brings that up to date with what process() has written since, as often as
+   it likes. setDelayMemory() back on the audio thread moves the state over, only copying what was
+   written after the last catch-up. As much recent history as the old memory held carries over. */
+struct DelayMemoryGrowth
+{
+    const float* previousBuffer = nullptr;
+    int previousLength = 0;
+    int previousWriteHead = 0;
+    int64_t previousFramesWritten = 0;
+    double engineSampleRate = 0;
+
+    float* circularBuffer = nullptr;
+    int length = 0;
+    int64_t framesCopied = 0;       // the frames written before this are in the new memory
+};
+
+namespace detail
+{
+    /* Frames are numbered by state.framesWritten. Where a frame is in the old memory, going by
+       where the write head was when the growth began, and where it goes in the new memory,
+       which starts with the oldest frame the old memory held then. */
+    inline int getPreviousFramePosition (const DelayMemoryGrowth& growth, int64_t frame)
+    {
+        const int64_t offset = (frame - growth.previousFramesWritten) % growth.previousLength;
+        return (int) ((growth.previousWriteHead + offset + growth.previousLength) % growth.previousLength);
+    }
+
+    inline int getNewFramePosition (const DelayMemoryGrowth& growth, int64_t frame)
+    {
+        return (int) ((frame - growth.previousFramesWritten + growth.previousLength) % growth.length);
+    }
+
+    /* Copies or clears numFrames consecutive frames, wrapping around the ends of the memory */
+    inline void copyFrames (const DelayMemoryGrowth& growth, int64_t firstFrame, int64_t numFrames)
+    {
+        while (numFrames > 0) {
+            const int from = getPreviousFramePosition (growth, firstFrame);
+            const int to = getNewFramePosition (growth, firstFrame);
+            const int count = (int) std::min ({ numFrames, (int64_t) (growth.previousLength - from), (int64_t) (growth.length - to) });
+
+            std::memcpy (growth.circularBuffer + 2 * to, growth.previousBuffer + 2 * from, (size_t) count * 2 * sizeof (float));
+
+            firstFrame += count;
+            numFrames -= count;
+        }
+    }
+
+    inline void clearFrames (const DelayMemoryGrowth& growth, int64_t firstFrame, int64_t numFrames)
+    {
+        while (numFrames > 0) {
+            const int to = getNewFramePosition (growth, firstFrame);
+            const int count = (int) std::min (numFrames, (int64_t) (growth.length - to));
+
+            std::memset (growth.circularBuffer + 2 * to, 0, (size_t) count * 2 * sizeof (float));
+
+            firstFrame += count;
+            numFrames -= count;
+        }
+    }
+}
+
+/* Audio thread, between process() calls: notes where the state's history stands for growing its memory */
+inline DelayMemoryGrowth beginDelayMemoryGrowth (const State& state)
+{
+    DelayMemoryGrowth growth;
+    growth.previousBuffer = state.circularBuffer;
+    growth.previousLength = state.circularBufferLength;
+    growth.previousWriteHead = state.writeHead;
+    growth.previousFramesWritten = state.framesWritten;
+    growth.engineSampleRate = state.engineSampleRate;
+    return growth;
+}
+
+/* Any thread: copies the history as it stood at beginDelayMemoryGrowth() to the start of
+   getCircularBufferSize (sampleRate, multirate, delayTime) floats of zeroed memory, for a longer
+   delay range than the state's memory holds. process() may be running meanwhile. */
+inline void copyDelayHistory (DelayMemoryGrowth& growth, float* circularBuffer, double delayTime)
+{
+    growth.circularBuffer = circularBuffer;
+    growth.length = getCircularBufferLength (growth.engineSampleRate, delayTime);
+    growth.framesCopied = growth.previousFramesWritten;
+
+    /* The oldest frames can be overwritten while they are copied. By the time the state moves
+       over they are older than the history that carries over, and they get cleared again. */
+    detail::copyFrames (growth, growth.previousFramesWritten - growth.previousLength, growth.previousLength);
+}
+
+/* Any thread after copyDelayHistory(), or the audio thread from setDelayMemory(): copies the
+   frames written since the last copy up to framesWritten, a state.framesWritten the audio thread
+   has published between process() calls, and clears those that have become too old to keep */
+inline void catchUpDelayHistory (DelayMemoryGrowth& growth, int64_t framesWritten)
+{
+    if (framesWritten <= growth.framesCopied) {
+        return;
+    }
+
+    /* The old memory keeps previousLength frames, the new one has room for length */
+    const int64_t oldestKept = framesWritten - growth.previousLength;
+    const int64_t clearFrom = std::max (growth.framesCopied - growth.previousLength, framesWritten - growth.length);
+    const int64_t copyFrom = std::max (growth.framesCopied, oldestKept);
+
+    detail::clearFrames (growth, clearFrom, oldestKept - clearFrom);
+    detail::copyFrames (growth, copyFrom, framesWritten - copyFrom);
+
+    growth.framesCopied = framesWritten;
+}
+
+/* Audio thread, between process() calls: moves the state onto the memory of a growth begun on it,
+   catching up with the frames written since the last copy, and returns the memory it used before
+   for the caller to free. The state must not have been reset or seeked since the growth began. */
+inline float* setDelayMemory (State& state, DelayMemoryGrowth& growth)
+{
+    catchUpDelayHistory (growth, state.framesWritten);
+
+    float* previousBuffer = state.circularBuffer;
+
+    growth.circularBuffer[2 * growth.length] = growth.circularBuffer[0];
+    growth.circularBuffer[2 * growth.length + 1] = growth.circularBuffer[1];
+
+    state.circularBuffer = growth.circularBuffer;
+    state.circularBufferLength = growth.length;
+    state.writeHead = detail::getNewFramePosition (growth, state.framesWritten);
+
+    return previousBuffer;
+}
+
+/* All of the above in one go, on the audio thread or wherever process() runs: moves a prepared
+   state onto getCircularBufferSize (sampleRate, multirate, delayTime) floats of zeroed
+   caller-owned memory and returns the memory it used before for the caller to free */
+inline float* setDelayMemory (State& state, float* circularBuffer, double delayTime)
+{
+    DelayMemoryGrowth growth = beginDelayMemoryGrowth (state);
+    copyDelayHistory (growth, circularBuffer, delayTime);
+    return setDelayMemory (state, growth);
+}
+
+/* How many samples late process() puts out its output, which hosts need to compensate for */
+inline int getLatencySamples (const State& state)
+{
+    return state.decimation > 1 ? getMultirateLatency (state.decimation) : 0;
+}
+
+/* The LFO runs at a fixed rate from phase 0 at sample 0, so its phase anywhere is known up front */
+inline double getLFOPhaseAtSample (const Parameters& parameters, double sampleRate, int64_t samplePosition)
+{
+    return getLFOPhase ({ 0.0, parameters.rate, samplePosition }, sampleRate);
+}
+
+/* getLFOPhaseAtSample for Dual mode's flanger LFO */
+inline double getFlangerLFOPhaseAtSample (const Parameters& parameters, double sampleRate, int64_t samplePosition)
+{
+    return getLFOPhase ({ 0.0, parameters.flangerRate, samplePosition }, sampleRate);
+}
+
+/* Sets the phases of the LFOs at the start of the next quantum */
+inline void setLFOPhase (State& state, double phase, double flangerPhase = 0.0)
+{
+    state.lfo.originPhase = phase - std::floor (phase);
+    state.lfo.position = 0;
+    state.flangerLfo.originPhase = flangerPhase - std::floor (flangerPhase);
+    state.flangerLfo.position = 0;
+}
+
+namespace detail
+{
+    /* Puts both LFOs samplePosition samples on from phase 0 at the current rates, which is
+       exactly where a run from sample 0 at those rates has them */
+    inline void setLFOPosition (State& state, const Parameters& parameters, int64_t samplePosition)
+    {
+        state.lfo = { 0.0, parameters.rate, samplePosition };
+        state.flangerLfo = { 0.0, parameters.flangerRate, samplePosition };
+    }
+}
+
+/* Locks the LFOs to a timeline. Called before process() with the position of the block's first
+   sample, it sets the phases the next quantum starts with to getLFOPhaseAtSample() of that
+   quantum's first sample, so calling it for every block keeps them where a render from sample 0
+   would have them, with no drift and whatever was processed before. The phases follow from the
+   current rates, so changing a rate moves them. */
+inline void setLFOPhaseAtSample (State& state, const Parameters& parameters, int64_t samplePosition)
+{
+    /* The next quantum starts once the current one is done, and with multirate processing it
+       starts from input the engine hasn't taken yet */
+    int64_t quantumStart = samplePosition;
+
+    if (state.quantumPosition > 0) {
+        quantumStart += (int64_t) (processingQuantum - state.quantumPosition) * state.decimation;
+    }
+
+    if (state.decimation > 1) {
+        quantumStart -= state.multirate.numPending;
+    }
+
+    detail::setLFOPosition (state, parameters, quantumStart);
+}
+
+/* Starts a freshly prepared or reset state as if it had already processed samplePosition samples
+   from sample 0: the LFOs where they would be, and the delay lines written from where they would
+   be. A render from a position on the quantum grid then puts out exactly what a render from
+   sample 0 does there, once the pre-roll has flushed out the input before it. */
+inline void seek (State& state, const Parameters& parameters, int64_t samplePosition)
+{
+    state.framesWritten = samplePosition / state.decimation;
+    state.writeHead = (int) (state.framesWritten % state.circularBufferLength);
+
+    detail::setLFOPosition (state, parameters, samplePosition);
+}
+
+/* Switches the wet path to a new quality from the next quantum, crossfading from the old one
+   over qualityFadeLength samples. Returns false without changing anything while an earlier
+   change is still waiting to start or fading. */
+inline bool setQuality (State& state, const Quality& quality)
+{
+    if (quality == state.targetQuality) {
+        return true;
+    }
+
+    if (state.qualityFadeRemaining > 0 || state.targetQuality != state.quality) {
+        return false;
+    }
+
+    state.targetQuality = quality;
+    return true;
+}
+
+/* How many samples of input it takes for the feedback tail of earlier input to decay below floorDb */
+inline int getPreRollSamples (const Parameters& parameters, double sampleRate, float floorDb)
+{
+    float minDelayTime, maxDelayTime;
+    getDelayTimeRange (parameters, parameters.type, minDelayTime, maxDelayTime);
+
+    /* The output depends on the input up to the longest delay back, and every trip
+       around the feedback loop adds another delay attenuated by the feedback gain */
+    float trips = 0;
+    if (parameters.feedback > 0) {
+        trips = std::ceil (floorDb / (20.0f * std::log10 (parameters.feedback)));
+    }
+
+    return (int) std::ceil ((1 + trips) * maxDelayTime * sampleRate) + 1;
+}
+
+//==============================================================================
+namespace detail
+{
+    inline void mix (const DSPKernels& kernels, const float* dryLeft, const float* dryRight, const float* wetLeft, const float* wetRight,
+                     float* outLeft, float* outRight, int numSamples, float dryAmount, float wetAmount)
+    {
+        kernels.mix (dryLeft, dryRight, wetLeft, wetRight, outLeft, outRight, numSamples, dryAmount, wetAmount);
+    }
+
+    inline void mix (const DSPKernels& kernels, const double* dryLeft, const double* dryRight, const float* wetLeft, const float* wetRight,
+                     double* outLeft, double* outRight, int numSamples, float dryAmount, float wetAmount)
+    {
+        kernels.mixDouble (dryLeft, dryRight, wetLeft, wetRight, outLeft, outRight, numSamples, dryAmount, wetAmount);
+    }
+
+    /* Runs an engine's LFOs over a whole quantum from a phase at a quality and maps them to delay times */
+    inline void computeDelayTimes (const DSPKernels& kernels, const Quality& quality, const float* wavetable,
+                                   double phase, float phaseIncrement, float phaseOffset, float depth,
+                                   float minDelaySamples, float maxDelaySamples, float* delayLeft, float* delayRight)
+    {
+        const int interval = std::min (std::max (1, quality.controlInterval), processingQuantum);
+
+        if (interval == 1) {
+            kernels.lfo (delayLeft, delayRight, processingQuantum, wavetable,
+                         (float) phase, phaseIncrement, phaseOffset, depth,
+                         minDelaySamples, maxDelaySamples);
+            return;
+        }
+
+        /* Evaluate the LFOs every controlInterval samples, including one point at or past the
+           end of the quantum, and ramp the delay times linearly between the points */
+        const int numPoints = (processingQuantum - 1) / interval + 2;
+
+        float controlLeft[processingQuantum + 1];
+        float controlRight[processingQuantum + 1];
+
+        kernels.lfo (controlLeft, controlRight, numPoints, wavetable,
+                     (float) phase, phaseIncrement * interval, phaseOffset, depth,
+                     minDelaySamples, maxDelaySamples);
+
+        for (int i = 0; i < processingQuantum; i++) {
+            const int point = i / interval;
+            const float position = (float) (i - point * interval) / interval;
+
+            delayLeft[i] = lin_interp (controlLeft[point], controlLeft[point + 1], position);
+            delayRight[i] = lin_interp (controlRight[point], controlRight[point + 1], position);
+        }
+    }
+
+    /* Delay times of one engine over the quantum, at the current quality and while fading at the
+       previous one too, then moves its LFO on to the next quantum */
+    inline void runEngine (State& state, LFOState& lfo, float minDelayTime, float maxDelayTime, float rate, float depth,
+                           const float* wavetable, float* delayLeft, float* delayRight, float* fadeDelayLeft, float* fadeDelayRight)
+    {
+        const float sampleRate = (float) state.engineSampleRate;
+        const float minDelaySamples = sampleRate * minDelayTime;
+        const float maxDelaySamples = sampleRate * maxDelayTime;
+        const double phaseIncrement = (double) rate / state.engineSampleRate;
+        const float phaseOffset = state.quantumParameters.phaseOffset;
+
+        if (rate != lfo.rate) {
+            lfo.originPhase = getLFOPhase (lfo, state.sampleRate);
+            lfo.position = 0;
+            lfo.rate = rate;
+        }
+
+        double phase = getLFOPhase (lfo, state.sampleRate);
+
+        if (state.decimation > 1) {
+            phase -= state.lfoLag * phaseIncrement;
+            phase -= std::floor (phase);
+        }
+
+        computeDelayTimes (*state.kernels, state.quality, wavetable, phase, (float) phaseIncrement, phaseOffset, depth,
+                           minDelaySamples, maxDelaySamples, delayLeft, delayRight);
+
+        if (state.qualityFadeRemaining > 0) {
+            computeDelayTimes (*state.kernels, state.previousQuality, wavetable, phase, (float) phaseIncrement, phaseOffset, depth,
+                               minDelaySamples, maxDelaySamples, fadeDelayLeft, fadeDelayRight);
+        }
+
+        /* Moving LFO phase forward to the next quantum */
+        lfo.position += processingQuantum * state.decimation;
+    }
+
+    /* Reads the delay lines behind the write head at the given delay times */
+    inline void readDelayLines (const State& state, Interpolation interpolation,
+                                const float* delayLeft, const float* delayRight,
+                                float* outLeft, float* outRight, int numSamples)
+    {
+        const DSPKernels& kernels = *state.kernels;
+
+        if (interpolation == Interpolation::Nearest) {
+            kernels.delayReadNearest (state.circularBuffer, state.circularBufferLength, state.writeHead,
+                                      delayLeft, delayRight, outLeft, outRight, numSamples);
+        } else {
+            kernels.delayRead (state.circularBuffer, state.circularBufferLength, state.writeHead,
+                               delayLeft, delayRight, outLeft, outRight, numSamples);
+        }
+    }
+
+    /* Both channels of a frame in one 64-bit store rather than two 32-bit ones */
+    inline void writeFrame (float* frame, float left, float right)
+    {
+        const float pair[2] = { left, right };
+        std::memcpy (frame, pair, sizeof (pair));
+    }
+
+    inline float smooth (float current, float target, float coefficient)
+    {
+        float next = current + (target - current) * coefficient;
+
+        /* Land exactly on the target, so settled parameters don't keep changing the output */
+        return std::abs (target - next) < 1.0e-5f ? target : next;
+    }
+
+    /* Control-rate work for a new quantum: parameter smoothing, quality changes and the LFOs */
+    inline void beginQuantum (State& state, const Parameters& parameters)
+    {
+        Parameters& current = state.quantumParameters;
+
+        if (state.parametersSmoothed) {
+            current.dryWet = smooth (current.dryWet, parameters.dryWet, state.smoothingCoefficient);
+            current.depth = smooth (current.depth, parameters.depth, state.smoothingCoefficient);
+            current.feedback = smooth (current.feedback, parameters.feedback, state.smoothingCoefficient);
+            current.distortion = smooth (current.distortion, parameters.distortion, state.smoothingCoefficient);
+            current.flangerDepth = smooth (current.flangerDepth, parameters.flangerDepth, state.smoothingCoefficient);
+            current.flangerMix = smooth (current.flangerMix, parameters.flangerMix, state.smoothingCoefficient);
+        } else {
+            current = parameters;
+            state.parametersSmoothed = true;
+        }
+
+        /* Rates and phase offset only move the LFOs, and the mode, shape and routing can't glide */
+        current.rate = parameters.rate;
+        current.flangerRate = parameters.flangerRate;
+        current.phaseOffset = parameters.phaseOffset;
+        current.type = parameters.type;
+        current.shape = parameters.shape;
+        current.routing = parameters.routing;
+
+        if (state.targetQuality != state.quality && state.qualityFadeRemaining == 0) {
+            state.previousQuality = state.quality;
+            state.quality = state.targetQuality;
+            state.qualityFadeRemaining = qualityFadeLength;
+        }
+
+        /* Delay ranges of the engines. Dual mode's main engine is the chorus. */
+        const bool dual = current.type == Dual;
+        float minDelayTime, maxDelayTime, flangerMinDelayTime, flangerMaxDelayTime;
+        getDelayTimeRange (current, dual ? Jello : current.type, minDelayTime, maxDelayTime);
+        getDelayTimeRange (Wavy, flangerMinDelayTime, flangerMaxDelayTime);
+
+        /* A range longer than the delay memory holds, while more is on its way, is held to what
+           it reaches. Dual mode's serial tap reads back as far as both engines together. */
+        float reach = (float) ((state.circularBufferLength - 2) / state.engineSampleRate);
+        if (dual) {
+            reach -= flangerMaxDelayTime;
+        }
+
+        maxDelayTime = std::min (maxDelayTime, reach);
+        minDelayTime = std::min (minDelayTime, maxDelayTime);
+
+        /* No read in a chunk can reach a sample written later in the same chunk as long as
+           the chunk is no longer than the shortest delay, so a whole chunk is read at once */
+        const float shortestDelayTime = dual ? std::min (minDelayTime, flangerMinDelayTime) : minDelayTime;
+        state.quantumMaxChunkLength = std::max (1, std::min (processingQuantum, (int) ((float) state.engineSampleRate * shortestDelayTime)));
+
+        /* Map the LFO output to the delay times */
+        const float* wavetable = getWavetable (current.shape);
+
+        runEngine (state, state.lfo, minDelayTime, maxDelayTime, current.rate, current.depth, wavetable,
+                   state.quantumDelayLeft, state.quantumDelayRight, state.quantumFadeDelayLeft, state.quantumFadeDelayRight);
+
+        if (dual) {
+            runEngine (state, state.flangerLfo, flangerMinDelayTime, flangerMaxDelayTime, current.flangerRate, current.flangerDepth,
+                       wavetable, state.quantumFlangerDelayLeft, state.quantumFlangerDelayRight,
+                       state.quantumFadeFlangerDelayLeft, state.quantumFadeFlangerDelayRight);
+        }
+    }
+
+    /* Delay line reads of one chunk: the main engine and, in Dual mode, the flanger and for
+       serial routing the flanger reading the chorus */
+    struct Taps
+    {
+        float left[processingQuantum];
+        float right[processingQuantum];
+        float flangerLeft[processingQuantum];
+        float flangerRight[processingQuantum];
+        float serialLeft[processingQuantum];
+        float serialRight[processingQuantum];
+    };
+
+    /* Reads every tap of the chunk at the current position, from the delay times the quantum
+       worked out at the current quality or, for fade, at the previous one */
+    inline void readTaps (const State& state, Interpolation interpolation, bool fade, int numSamples, Taps& taps)
+    {
+        const int position = state.quantumPosition;
+        const float* delayLeft = (fade ? state.quantumFadeDelayLeft : state.quantumDelayLeft) + position;
+        const float* delayRight = (fade ? state.quantumFadeDelayRight : state.quantumDelayRight) + position;
+
+        if (state.quantumParameters.type != Dual) {
+            readDelayLines (state, interpolation, delayLeft, delayRight, taps.left, taps.right, numSamples);
+            return;
+        }
+
+        const float* flangerDelayLeft = (fade ? state.quantumFadeFlangerDelayLeft : state.quantumFlangerDelayLeft) + position;
+        const float* flangerDelayRight = (fade ? state.quantumFadeFlangerDelayRight : state.quantumFlangerDelayRight) + position;
+
+        /* Both engines in one pass over the buffer */
+        if (interpolation == Interpolation::Linear) {
+            state.kernels->delayReadDual (state.circularBuffer, state.circularBufferLength, state.writeHead,
+                                          delayLeft, delayRight, flangerDelayLeft, flangerDelayRight,
+                                          taps.left, taps.right, taps.flangerLeft, taps.flangerRight, numSamples);
+        } else {
+            readDelayLines (state, interpolation, delayLeft, delayRight, taps.left, taps.right, numSamples);
+            readDelayLines (state, interpolation, flangerDelayLeft, flangerDelayRight, taps.flangerLeft, taps.flangerRight, numSamples);
+        }
+
+        /* The flanger's delayed copy of the chorus output is the input delayed by both, taking
+           the chorus delay at the time of the read since it barely moves over a flanger delay */
+        if (state.quantumParameters.routing == Serial) {
+            float serialDelayLeft[processingQuantum];
+            float serialDelayRight[processingQuantum];
+
+            for (int i = 0; i < numSamples; i++) {
+                serialDelayLeft[i] = delayLeft[i] + flangerDelayLeft[i];
+                serialDelayRight[i] = delayRight[i] + flangerDelayRight[i];
+            }
+
+            readDelayLines (state, interpolation, serialDelayLeft, serialDelayRight, taps.serialLeft, taps.serialRight, numSamples);
+        }
+    }
+
+    /* How much of the dry signal Dual mode keeps. Parallel routing averages a chorus and a
+       flanger each mixing in their own wet signal, serial runs the chorus's output through
+       the flanger. */
+    inline float getDualDryAmount (const Parameters& parameters)
+    {
+        const float chorusMix = parameters.dryWet;
+        const float flangerMix = parameters.flangerMix;
+
+        if (parameters.routing == Serial) {
+            return (1 - chorusMix) * (1 - flangerMix);
+        }
+
+        return 1 - 0.5f * (chorusMix + flangerMix);
+    }
+
+    /* Dual mode's wet signal for one channel, mixed with getDualDryAmount of the dry signal, and
+       what it feeds back: the engines at full mix, averaged or in series */
+    inline void combineEngines (const Parameters& parameters, const float* chorus, const float* flanger, const float* serial,
+                                float* wet, float* loop, int numSamples)
+    {
+        const float chorusMix = parameters.dryWet;
+        const float flangerMix = parameters.flangerMix;
+
+        if (parameters.routing == Serial) {
+            const float chorusAmount = chorusMix * (1 - flangerMix);
+            const float flangerAmount = (1 - chorusMix) * flangerMix;
+            const float serialAmount = chorusMix * flangerMix;
+
+            for (int i = 0; i < numSamples; i++) {
+                wet[i] = chorus[i] * chorusAmount + flanger[i] * flangerAmount + serial[i] * serialAmount;
+                loop[i] = serial[i];
+            }
+        } else {
+            for (int i = 0; i < numSamples; i++) {
+                wet[i] = 0.5f * (chorus[i] * chorusMix + flanger[i] * flangerMix);
+                loop[i] = 0.5f * (chorus[i] + flanger[i]);
+            }
+        }
+    }
+
+    inline void saturate (const DSPKernels& kernels, Saturation saturation, float* samples, int numSamples, float distortion)
+    {
+        if (saturation == Saturation::Rational) {
+            kernels.saturateFast (samples, numSamples, distortion);
+        } else {
+            kernels.saturate (samples, numSamples, distortion);
+        }
+    }
+
+    /* a = a * (1 - fade) + b * fade, per sample */
+    inline void crossfade (float* a, const float* b, const float* fade, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++) {
+            a[i] = lin_interp (a[i], b[i], fade[i]);
+        }
+    }
+
+    /* Crossfades every tap of the chunk that was read towards the reads at the previous quality */
+    inline void crossfadeTaps (const Parameters& parameters, Taps& taps, const Taps& fadeTaps, const float* fade, int numSamples)
+    {
+        crossfade (taps.left, fadeTaps.left, fade, numSamples);
+        crossfade (taps.right, fadeTaps.right, fade, numSamples);
+
+        if (parameters.type == Dual) {
+            crossfade (taps.flangerLeft, fadeTaps.flangerLeft, fade, numSamples);
+            crossfade (taps.flangerRight, fadeTaps.flangerRight, fade, numSamples);
+
+            if (parameters.routing == Serial) {
+                crossfade (taps.serialLeft, fadeTaps.serialLeft, fade, numSamples);
+                crossfade (taps.serialRight, fadeTaps.serialRight, fade, numSamples);
+            }
+        }
+    }
+}
+
+namespace detail
+{
+    /* The effect over frames samples of one stereo signal, in quanta and chunks. With dryGains,
+       out gets only the wet signal at its gain and dryGains the gain for the dry one, for the
+       multirate path to mix in itself. */
+    template <typename SampleType>
+    void processChunks (State& state, const Parameters& parameters, const SampleType* inLeft, const SampleType* inRight,
+                        SampleType* outLeft, SampleType* outRight, int frames, float* dryGains)
+    {
+        const DSPKernels& kernels = *state.kernels;
+
+        /* Reads at the current quality, and at the previous one with their weight while a quality change fades */
+        Taps taps;
+        Taps fadeTaps;
+        float fadeGain[processingQuantum];
+
+        /* Dual mode's engines combined, for the output and for the feedback */
+        float dualWetLeft[processingQuantum];
+        float dualWetRight[processingQuantum];
+        float dualLoopLeft[processingQuantum];
+        float dualLoopRight[processingQuantum];
+
+        /* A host block may end and the next one start anywhere inside a quantum; the remainder
+           of a quantum is processed straight away from what its start worked out, so the
+           output doesn't depend on the block size and nothing is delayed */
+        for (int start = 0; start < frames;) {
+            if (state.quantumPosition == 0) {
+                beginQuantum (state, parameters);
+            }
+
+            const Parameters& current = state.quantumParameters;
+            const bool dual = current.type == Dual;
+            float wetAmount = current.dryWet;
+            float dryAmount = 1 - wetAmount;
+
+            /* Chunks never cross a quantum boundary or wrap around the end of the circular buffer */
+            const int chunkLength = std::min ({ state.quantumMaxChunkLength, processingQuantum - state.quantumPosition,
+                                                frames - start, state.circularBufferLength - state.writeHead });
+
+            float* frame = state.circularBuffer + 2 * state.writeHead;
+
+            /* Write the first frame before reading, the shortest delays can reach it */
+            writeFrame (frame, (float) inLeft[start] + state.feedbackLeft, (float) inRight[start] + state.feedbackRight);
+
+            /* Chunks never wrap, so frame 0 is only ever written here. Keep the guard frame in sync. */
+            if (state.writeHead == 0) {
+                std::memcpy (state.circularBuffer + 2 * state.circularBufferLength, frame, 2 * sizeof (float));
+            }
+
+            /* generate the actual samples */
+            readTaps (state, state.quality.interpolation, false, chunkLength, taps);
+
+            /* While the quality changes, read at the old quality too and fade from it, so the
+               feedback and the output never step */
+            const bool fading = state.qualityFadeRemaining > 0;
+
+            if (fading) {
+                readTaps (state, state.previousQuality.interpolation, true, chunkLength, fadeTaps);
+
+                for (int i = 0; i < chunkLength; i++) {
+                    fadeGain[i] = std::max (0, state.qualityFadeRemaining - i) / (float) qualityFadeLength;
+                }
+
+                crossfadeTaps (current, taps, fadeTaps, fadeGain, chunkLength);
+            }
+
+            /* What is fed back and what is mixed in, the same reads except in Dual mode */
+            float* wetLeft = taps.left;
+            float* wetRight = taps.right;
+            const float* loopLeft = taps.left;
+            const float* loopRight = taps.right;
+
+            if (dual) {
+                combineEngines (current, taps.left, taps.flangerLeft, taps.serialLeft, dualWetLeft, dualLoopLeft, chunkLength);
+                combineEngines (current, taps.right, taps.flangerRight, taps.serialRight, dualWetRight, dualLoopRight, chunkLength);
+
+                wetLeft = dualWetLeft;
+                wetRight = dualWetRight;
+                loopLeft = dualLoopLeft;
+                loopRight = dualLoopRight;
+                dryAmount = getDualDryAmount (current);
+                wetAmount = 1;
+            }
+
+            /* Write the rest of the chunk, each frame carrying the feedback of the previous read */
+            for (int i = 1; i < chunkLength; i++) {
+                writeFrame (frame + 2 * i, (float) inLeft[start + i] + loopLeft[i - 1] * current.feedback,
+                            (float) inRight[start + i] + loopRight[i - 1] * current.feedback);
+            }
+
+            state.feedbackLeft = loopLeft[chunkLength - 1] * current.feedback;
+            state.feedbackRight = loopRight[chunkLength - 1] * current.feedback;
+
+            // Apply distortion for Tormentrix mode
+            if (current.type == Tormentrix && current.distortion > 0.0f) {
+                if (fading && state.previousQuality.saturation != state.quality.saturation) {
+                    std::memcpy (fadeTaps.left, wetLeft, (size_t) chunkLength * sizeof (float));
+                    std::memcpy (fadeTaps.right, wetRight, (size_t) chunkLength * sizeof (float));
+
+                    saturate (kernels, state.previousQuality.saturation, fadeTaps.left, chunkLength, current.distortion);
+                    saturate (kernels, state.previousQuality.saturation, fadeTaps.right, chunkLength, current.distortion);
+                }
+
+                saturate (kernels, state.quality.saturation, wetLeft, chunkLength, current.distortion);
+                saturate (kernels, state.quality.saturation, wetRight, chunkLength, current.distortion);
+
+                if (fading && state.previousQuality.saturation != state.quality.saturation) {
+                    crossfade (wetLeft, fadeTaps.left, fadeGain, chunkLength);
+                    crossfade (wetRight, fadeTaps.right, fadeGain, chunkLength);
+                }
+            }
+
+            if (fading) {
+                state.qualityFadeRemaining = std::max (0, state.qualityFadeRemaining - chunkLength);
+            }
+
+            if (dryGains != nullptr) {
+                for (int i = 0; i < chunkLength; i++) {
+                    outLeft[start + i] = wetLeft[i] * wetAmount;
+                    outRight[start + i] = wetRight[i] * wetAmount;
+                    dryGains[start + i] = dryAmount;
+                }
+            } else {
+                /* Both channels in one call, a one sample chunk is mostly call overhead */
+                mix (kernels, inLeft + start, inRight + start, wetLeft, wetRight, outLeft + start,
+                     outRight != nullptr ? outRight + start : nullptr, chunkLength, dryAmount, wetAmount);
+            }
+
+            state.writeHead += chunkLength;
+            state.framesWritten += chunkLength;
+
+            if (state.writeHead >= state.circularBufferLength) {
+                state.writeHead = 0;
+            }
+
+            state.quantumPosition += chunkLength;
+
+            if (state.quantumPosition == processingQuantum) {
+                state.quantumPosition = 0;
+            }
+
+            start += chunkLength;
+        }
+    }
+
+    /* processChunks at the engine rate with the filters either side of it. The input is taken
+       a whole engine sample at a time, and the wet signal that comes back up is mixed with the
+       delayed dry signal from a queue that stays decimation - 1 samples ahead of the input. */
+    template <typename SampleType>
+    void processMultirate (State& state, const Parameters& parameters, const SampleType* inLeft, const SampleType* inRight,
+                           SampleType* outLeft, SampleType* outRight, int frames)
+    {
+        const DSPKernels& kernels = *state.kernels;
+        MultirateState& multirate = state.multirate;
+        const int decimation = state.decimation;
+        const int numStages = getNumMultirateStages (decimation);
+        const int latency = getMultirateLatency (decimation);
+
+        float left[multirateBlockLength];
+        float right[multirateBlockLength];
+        float scratchLeft[multirateBlockLength];
+        float scratchRight[multirateBlockLength];
+        float dryGains[multirateBlockLength];
+        double dryLeft[maxMultirateLatency + multirateBlockLength];
+        double dryRight[maxMultirateLatency + multirateBlockLength];
+
+        /* The queue's first gains after a reset are the first quantum's */
+        for (int i = 0; i < multirate.numWet; i++) {
+            if (multirate.dryGain[i] < 0) {
+                multirate.dryGain[i] = parameters.type == Dual ? getDualDryAmount (parameters) : 1 - parameters.dryWet;
+            }
+        }
+
+        std::memcpy (dryLeft, multirate.dryLeft, (size_t) latency * sizeof (double));
+        std::memcpy (dryRight, multirate.dryRight, (size_t) latency * sizeof (double));
+
+        for (int start = 0; start < frames;) {
+            const int numPending = multirate.numPending;
+            const int blockLength = std::min (frames - start, multirateBlockLength - numPending);
+            const int numInput = numPending + blockLength;
+            const int numEngine = numInput / decimation;
+            const int numUsed = numEngine * decimation;
+
+            std::memcpy (left, multirate.pendingLeft, (size_t) numPending * sizeof (float));
+            std::memcpy (right, multirate.pendingRight, (size_t) numPending * sizeof (float));
+
+            /* The engine's input, and the dry signal after the latency samples before it */
+            for (int i = 0; i < blockLength; i++) {
+                left[numPending + i] = (float) inLeft[start + i];
+                right[numPending + i] = (float) inRight[start + i];
+                dryLeft[latency + i] = inLeft[start + i];
+                dryRight[latency + i] = inRight[start + i];
+            }
+
+            multirate.numPending = numInput - numUsed;
+            std::memcpy (multirate.pendingLeft, left + numUsed, (size_t) multirate.numPending * sizeof (float));
+            std::memcpy (multirate.pendingRight, right + numUsed, (size_t) multirate.numPending * sizeof (float));
+
+            if (numEngine > 0) {
+                /* Down to the engine rate in place, the first stage at the full rate */
+                for (int stage = 0; stage < numStages; stage++) {
+                    const HalfbandCoefficients& coefficients = getHalfbandCoefficients (stage == numStages - 1);
+                    const int numOutputs = numUsed >> (stage + 1);
+
+                    decimate (kernels, coefficients, multirate.halfbands[stage][0], left, left, numOutputs);
+                    decimate (kernels, coefficients, multirate.halfbands[stage][1], right, right, numOutputs);
+                }
+
+                processChunks (state, parameters, left, right, left, right, numEngine, dryGains);
+
+                /* And back up, ping-ponging through the scratch buffers into the queue */
+                float* sourceLeft = left;
+                float* sourceRight = right;
+
+                for (int stage = numStages - 1; stage >= 0; stage--) {
+                    const HalfbandCoefficients& coefficients = getHalfbandCoefficients (stage == numStages - 1);
+                    const int numInputs = numUsed >> (stage + 1);
+
+                    float* destinationLeft = stage == 0 ? multirate.wetLeft + multirate.numWet
+                                                        : (sourceLeft == left ? scratchLeft : left);
+                    float* destinationRight = stage == 0 ? multirate.wetRight + multirate.numWet
+                                                         : (sourceRight == right ? scratchRight : right);
+
+                    interpolate (kernels, coefficients, multirate.halfbands[stage][0], sourceLeft, destinationLeft, numInputs);
+                    interpolate (kernels, coefficients, multirate.halfbands[stage][1], sourceRight, destinationRight, numInputs);
+
+                    sourceLeft = destinationLeft;
+                    sourceRight = destinationRight;
+                }
+
+                float* dryGain = multirate.dryGain + multirate.numWet;
+
+                for (int i = 0; i < numUsed; i++) {
+                    dryGain[i] = dryGains[i >> numStages];
+                }
+
+                multirate.numWet += numUsed;
+            }
+
+            /* Mix with the dry signal from latency samples back */
+            for (int i = 0; i < blockLength; i++) {
+                outLeft[start + i] = (SampleType) (dryLeft[i] * multirate.dryGain[i] + multirate.wetLeft[i]);
+            }
+
+            if (outRight != nullptr) {
+                for (int i = 0; i < blockLength; i++) {
+                    outRight[start + i] = (SampleType) (dryRight[i] * multirate.dryGain[i] + multirate.wetRight[i]);
+                }
+            }
+
+            std::memmove (dryLeft, dryLeft + blockLength, (size_t) latency * sizeof (double));
+            std::memmove (dryRight, dryRight + blockLength, (size_t) latency * sizeof (double));
+
+            multirate.numWet -= blockLength;
+            std::memmove (multirate.wetLeft, multirate.wetLeft + blockLength, (size_t) multirate.numWet * sizeof (float));
+            std::memmove (multirate.wetRight, multirate.wetRight + blockLength, (size_t) multirate.numWet * sizeof (float));
+            std::memmove (multirate.dryGain, multirate.dryGain + blockLength, (size_t) multirate.numWet * sizeof (float));
+
+            start += blockLength;
+        }
+
+        std::memcpy (multirate.dryLeft, dryLeft, (size_t) latency * sizeof (double));
+        std::memcpy (multirate.dryRight, dryRight, (size_t) latency * sizeof (double));
+    }
+}
+
+/* Runs the effect over frames samples of float or double audio. Channel 0 is left and
+   channel 1 right; a mono signal runs through the left channel and any channels past
+   the second pass through. in and out may point at the same buffers. */
+template <typename SampleType>
+void process (State& state, const Parameters& parameters,
+              const SampleType* const* in, SampleType* const* out, int channels, int frames)
+{
+    if (channels <= 0 || frames <= 0 || state.circularBuffer == nullptr) {
+        return;
+    }
+
+    ScopedRealtimeSection realtimeSection;
+
+    /* Obtain the left and right audio data pointers */
+    const SampleType* inLeft = in[0];
+    const SampleType* inRight = in[channels > 1 ? 1 : 0];
+    SampleType* outLeft = out[0];
+    SampleType* outRight = channels > 1 ? out[1] : nullptr;
+
+    for (int channel = 2; channel < channels; channel++) {
+        if (in[channel] != out[channel]) {
+            std::memcpy (out[channel], in[channel], (size_t) frames * sizeof (SampleType));
+        }
+    }
+
+    if (state.decimation > 1) {
+        detail::processMultirate (state, parameters, inLeft, inRight, outLeft, outRight, frames);
+    } else {
+        detail::processChunks (state, parameters, inLeft, inRight, outLeft, outRight, frames, (float*) nullptr);
+    }
+}
+
+} // namespace chaorus
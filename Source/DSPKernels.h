@@ -0,0 +1,540 @@
+/*
+  ==============================================================================
+
+    DSPKernels.h
+
+    The hot inner loops of the effect, compiled for several instruction set
+    levels in the same binary. Every kernel body is written once and then
+    stamped out per level with a target attribute, so the compiler can
+    vectorise the same loop for SSE2, AVX2 and AVX-512. The best level the
+    CPU supports is picked once and callers go through the resulting table
+    of function pointers.
+
+    Header-only and free of JUCE, like the rest of the DSP core.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LFOWavetables.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+/* Per-function target attributes are a GCC/Clang feature. MSVC and non-x86
+   builds only get the baseline kernels, which is whatever the compiler
+   targets by default (SSE2 on x86-64, NEON on arm64). */
+#if (defined (__GNUC__) || defined (__clang__)) && (defined (__x86_64__) || defined (__i386__))
+ #define CHAORUS_MULTIVERSION_KERNELS 1
+ #define CHAORUS_INLINE inline __attribute__((always_inline))
+ #define CHAORUS_TARGET_AVX2 __attribute__((target ("avx2,fma")))
+ #define CHAORUS_TARGET_AVX512 __attribute__((target ("avx512f,avx512vl,avx512bw,avx512dq,avx2,fma")))
+#else
+ #define CHAORUS_MULTIVERSION_KERNELS 0
+ #define CHAORUS_INLINE inline
+#endif
+
+namespace chaorus
+{
+
+/* Instruction set levels the kernels are built for */
+enum class KernelLevel
+{
+    Baseline = 0,   // SSE2 on x86-64, NEON on arm64
+    AVX2,           // AVX2 + FMA
+    AVX512          // AVX-512 F/VL/BW/DQ
+};
+
+/* Table of kernels for a single instruction set level */
+struct DSPKernels
+{
+    /* Runs the left and right LFOs for numSamples samples and maps them to delay times in samples.
+       The LFO reads wavetable (wavetableSize + 1 entries) or is a sine when wavetable is nullptr. */
+    void (*lfo) (float* delayLeft, float* delayRight, int numSamples, const float* wavetable,
+                 float phase, float phaseIncrement, float phaseOffset, float depth,
+                 float minDelaySamples, float maxDelaySamples);
+
+    /* Reads the interleaved stereo circular buffer at each (fractional) delay behind writeHead
+       with linear interpolation. The buffer holds circularBufferLength [L, R] frames followed
+       by a guard frame that mirrors frame 0. */
+    void (*delayRead) (const float* circularBuffer, int circularBufferLength, int writeHead,
+                       const float* delayLeft, const float* delayRight,
+                       float* outLeft, float* outRight, int numSamples);
+
+    /* delayRead without interpolation, each read takes the nearest frame */
+    void (*delayReadNearest) (const float* circularBuffer, int circularBufferLength, int writeHead,
+                              const float* delayLeft, const float* delayRight,
+                              float* outLeft, float* outRight, int numSamples);
+
+    /* delayRead of two sets of delays in one pass, for the two engines of Dual mode */
+    void (*delayReadDual) (const float* circularBuffer, int circularBufferLength, int writeHead,
+                           const float* delayLeftA, const float* delayRightA,
+                           const float* delayLeftB, const float* delayRightB,
+                           float* outLeftA, float* outRightA, float* outLeftB, float* outRightB, int numSamples);
+
+    /* Tormentrix clip + tanh saturation, in place */
+    void (*saturate) (float* samples, int numSamples, float distortionAmount);
+
+    /* saturate with a rational approximation of tanh in place of std::tanh */
+    void (*saturateFast) (float* samples, int numSamples, float distortionAmount);
+
+    /* out = dry * dryAmount + wet * wetAmount for both channels in one call, out may be the same
+       as dry. outRight may be nullptr, for a mono output. */
+    void (*mix) (const float* dryLeft, const float* dryRight, const float* wetLeft, const float* wetRight,
+                 float* outLeft, float* outRight, int numSamples, float dryAmount, float wetAmount);
+
+    /* mix for double precision input and output, the wet signal comes from float delay lines */
+    void (*mixDouble) (const double* dryLeft, const double* dryRight, const float* wetLeft, const float* wetRight,
+                       double* outLeft, double* outRight, int numSamples, float dryAmount, float wetAmount);
+
+    /* out[i] += the FIR filter with numTaps (even, up to 64) symmetric coefficients at input[i],
+       for the multirate filters. Only the first numTaps / 2 coefficients are read, and input[i]
+       must be preceded by numTaps - 1 samples of history. */
+    void (*firSymmetric) (const float* input, const float* coefficients, int numTaps, float* out, int numSamples);
+
+    /* The kernels of the batched engine, over numLanes (4, 8 or 16) mono streams at once. Every
+       lane's samples are interleaved frame by frame, and each lane is worked out exactly as the
+       kernel above it works out a single stream. */
+
+    /* delayRead of a circular buffer of numLanes mono delay lines, one read per lane and sample */
+    void (*delayReadLanes) (const float* circularBuffer, int circularBufferLength, int writeHead, int numLanes,
+                            const float* delays, float* out, int numSamples);
+
+    /* saturate of each lane by its own amount, lanes whose amount isn't above 0 are left alone */
+    void (*saturateLanes) (float* samples, int numSamples, int numLanes, const float* distortionAmounts);
+
+    /* mix with amounts for each lane, out may be the same as dry */
+    void (*mixLanes) (const float* dry, const float* wet, float* out, int numSamples, int numLanes,
+                      const float* dryAmounts, const float* wetAmounts);
+
+    KernelLevel level;
+};
+
+inline float lin_interp (float sample_x, float sample_x1, float inPhase)
+{
+    return (1 - inPhase) * sample_x + inPhase * sample_x1;
+}
+
+namespace detail
+{
+    /* sin(2 * pi * phase) for phase >= 0. The phase is folded onto a quarter
+       wave and evaluated with an 11th order polynomial (error < 1e-7), which
+       unlike std::sin vectorises. */
+    CHAORUS_INLINE float sin2Pi (float phase)
+    {
+        float folded = phase + 0.75f;
+        folded -= (float) (int) folded;
+        float triangle = 2.0f * std::abs (2.0f * folded - 1.0f) - 1.0f;
+
+        float x = triangle * 1.57079632679f;
+        float x2 = x * x;
+        return x * (1.0f + x2 * (-1.0f / 6.0f + x2 * (1.0f / 120.0f + x2 * (-1.0f / 5040.0f
+                 + x2 * (1.0f / 362880.0f + x2 * (-1.0f / 39916800.0f))))));
+    }
+
+    /* Wavetable value at a phase in [0, 1) */
+    CHAORUS_INLINE float readWavetable (const float* wavetable, float phase)
+    {
+        float position = phase * wavetableSize;
+        int index = (int) position;
+        return lin_interp (wavetable[index], wavetable[index + 1], position - index);
+    }
+
+    CHAORUS_INLINE void lfoBody (float* delayLeft, float* delayRight, int numSamples, const float* wavetable,
+                                 float phase, float phaseIncrement, float phaseOffset, float depth,
+                                 float minDelaySamples, float maxDelaySamples)
+    {
+        const float halfRange = 0.5f * (maxDelaySamples - minDelaySamples);
+
+        /* Separate loops so neither has a branch inside */
+        if (wavetable == nullptr) {
+            for (int i = 0; i < numSamples; i++) {
+                float phaseLeft = phase + i * phaseIncrement;
+                phaseLeft -= (float) (int) phaseLeft;
+
+                float phaseRight = phaseLeft + phaseOffset;
+                phaseRight -= (float) (int) phaseRight;
+
+                delayLeft[i] = minDelaySamples + (depth * sin2Pi (phaseLeft) + 1.0f) * halfRange;
+                delayRight[i] = minDelaySamples + (depth * sin2Pi (phaseRight) + 1.0f) * halfRange;
+            }
+        } else {
+            for (int i = 0; i < numSamples; i++) {
+                float phaseLeft = phase + i * phaseIncrement;
+                phaseLeft -= (float) (int) phaseLeft;
+
+                /* The right channel reads the same table, offset in phase */
+                float phaseRight = phaseLeft + phaseOffset;
+                phaseRight -= (float) (int) phaseRight;
+
+                delayLeft[i] = minDelaySamples + (depth * readWavetable (wavetable, phaseLeft) + 1.0f) * halfRange;
+                delayRight[i] = minDelaySamples + (depth * readWavetable (wavetable, phaseRight) + 1.0f) * halfRange;
+            }
+        }
+    }
+
+    /* One channel (0 left, 1 right) read with linear interpolation, delay samples behind position.
+       Frames are numChannels floats, stereo except in the batched engine. The whole samples of
+       the delay are taken off position in integers, since a float read head only has an eighth
+       of a sample of precision a second or so into a long buffer. */
+    CHAORUS_INLINE float readLinear (const float* circularBuffer, int circularBufferLength, int position, float delay,
+                                     int channel, int numChannels = 2)
+    {
+        const int delayWhole = (int) delay;
+        const float delayFraction = delay - (float) delayWhole;
+
+        /* The frame before the one delayWhole back, the interpolation runs back from the next one */
+        int readHead_x = position - delayWhole - 1;
+        if (readHead_x < 0) {
+            readHead_x += circularBufferLength;
+        }
+
+        /* Frames x and x + 1 form one contiguous [L, R, L, R] quad, the guard frame keeps x + 1 in range */
+        const float* quad = circularBuffer + numChannels * readHead_x;
+        return lin_interp (quad[channel + numChannels], quad[channel], delayFraction);
+    }
+
+    CHAORUS_INLINE void delayReadBody (const float* circularBuffer, int circularBufferLength, int writeHead,
+                                       const float* delayLeft, const float* delayRight,
+                                       float* outLeft, float* outRight, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++) {
+            outLeft[i] = readLinear (circularBuffer, circularBufferLength, writeHead + i, delayLeft[i], 0);
+            outRight[i] = readLinear (circularBuffer, circularBufferLength, writeHead + i, delayRight[i], 1);
+        }
+    }
+
+    CHAORUS_INLINE void delayReadDualBody (const float* circularBuffer, int circularBufferLength, int writeHead,
+                                           const float* delayLeftA, const float* delayRightA,
+                                           const float* delayLeftB, const float* delayRightB,
+                                           float* outLeftA, float* outRightA, float* outLeftB, float* outRightB, int numSamples)
+    {
+        /* Four independent gathers per frame, which keeps more loads in flight than two passes */
+        for (int i = 0; i < numSamples; i++) {
+            outLeftA[i] = readLinear (circularBuffer, circularBufferLength, writeHead + i, delayLeftA[i], 0);
+            outRightA[i] = readLinear (circularBuffer, circularBufferLength, writeHead + i, delayRightA[i], 1);
+            outLeftB[i] = readLinear (circularBuffer, circularBufferLength, writeHead + i, delayLeftB[i], 0);
+            outRightB[i] = readLinear (circularBuffer, circularBufferLength, writeHead + i, delayRightB[i], 1);
+        }
+    }
+
+    CHAORUS_INLINE void delayReadNearestBody (const float* circularBuffer, int circularBufferLength, int writeHead,
+                                              const float* delayLeft, const float* delayRight,
+                                              float* outLeft, float* outRight, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++) {
+            /* Rounded in the delay rather than the read head, for the same reason as readLinear() */
+            int readHeadLeft = writeHead + i - (int) (delayLeft[i] + 0.5f);
+            if (readHeadLeft < 0) {
+                readHeadLeft += circularBufferLength;
+            }
+
+            int readHeadRight = writeHead + i - (int) (delayRight[i] + 0.5f);
+            if (readHeadRight < 0) {
+                readHeadRight += circularBufferLength;
+            }
+
+            outLeft[i] = circularBuffer[2 * readHeadLeft];
+            outRight[i] = circularBuffer[2 * readHeadRight + 1];
+        }
+    }
+
+    CHAORUS_INLINE void saturateBody (float* samples, int numSamples, float distortionAmount)
+    {
+        const float clipGain = 1.0f + distortionAmount * 3.0f;
+        const float tanhGain = 1.0f + distortionAmount * 2.0f;
+
+        for (int i = 0; i < numSamples; i++) {
+            float clipped = std::min (1.0f, std::max (-1.0f, samples[i] * clipGain));
+            samples[i] = std::tanh (clipped * tanhGain);
+        }
+    }
+
+    CHAORUS_INLINE void saturateFastBody (float* samples, int numSamples, float distortionAmount)
+    {
+        const float clipGain = 1.0f + distortionAmount * 3.0f;
+        const float tanhGain = 1.0f + distortionAmount * 2.0f;
+
+        for (int i = 0; i < numSamples; i++) {
+            /* Pade approximant of tanh, within 0.025 of it over the +-3 that bounds x here and
+               reaching 1 at +-3 where tanh is 0.995 */
+            float x = std::min (1.0f, std::max (-1.0f, samples[i] * clipGain)) * tanhGain;
+            float x2 = x * x;
+            samples[i] = x * (27.0f + x2) / (27.0f + 9.0f * x2);
+        }
+    }
+
+    template <typename SampleType>
+    CHAORUS_INLINE void mixBody (const SampleType* dry, const float* wet, SampleType* out, int numSamples, float dryAmount, float wetAmount)
+    {
+        for (int i = 0; i < numSamples; i++) {
+            out[i] = dry[i] * (SampleType) dryAmount + (SampleType) (wet[i] * wetAmount);
+        }
+    }
+
+    template <typename SampleType>
+    CHAORUS_INLINE void mixStereoBody (const SampleType* dryLeft, const SampleType* dryRight, const float* wetLeft, const float* wetRight,
+                                       SampleType* outLeft, SampleType* outRight, int numSamples, float dryAmount, float wetAmount)
+    {
+        mixBody (dryLeft, wetLeft, outLeft, numSamples, dryAmount, wetAmount);
+
+        if (outRight != nullptr) {
+            mixBody (dryRight, wetRight, outRight, numSamples, dryAmount, wetAmount);
+        }
+    }
+
+    /* The lane loops are innermost and a whole number of vectors long */
+    template <int numLanes>
+    CHAORUS_INLINE void delayReadLanesBody (const float* circularBuffer, int circularBufferLength, int writeHead,
+                                            const float* delays, float* out, int numSamples)
+    {
+        for (int i = 0; i < numSamples; i++) {
+            for (int lane = 0; lane < numLanes; lane++) {
+                out[i * numLanes + lane] = readLinear (circularBuffer, circularBufferLength, writeHead + i,
+                                                       delays[i * numLanes + lane], lane, numLanes);
+            }
+        }
+    }
+
+    CHAORUS_INLINE void delayReadLanesBody (const float* circularBuffer, int circularBufferLength, int writeHead, int numLanes,
+                                            const float* delays, float* out, int numSamples)
+    {
+        if (numLanes == 16) {
+            delayReadLanesBody<16> (circularBuffer, circularBufferLength, writeHead, delays, out, numSamples);
+        } else if (numLanes == 8) {
+            delayReadLanesBody<8> (circularBuffer, circularBufferLength, writeHead, delays, out, numSamples);
+        } else {
+            delayReadLanesBody<4> (circularBuffer, circularBufferLength, writeHead, delays, out, numSamples);
+        }
+    }
+
+    /* tanh doesn't vectorise either way, so this goes a lane at a time */
+    CHAORUS_INLINE void saturateLanesBody (float* samples, int numSamples, int numLanes, const float* distortionAmounts)
+    {
+        for (int lane = 0; lane < numLanes; lane++) {
+            const float distortionAmount = distortionAmounts[lane];
+
+            if (distortionAmount <= 0.0f) {
+                continue;
+            }
+
+            const float clipGain = 1.0f + distortionAmount * 3.0f;
+            const float tanhGain = 1.0f + distortionAmount * 2.0f;
+
+            for (int i = 0; i < numSamples; i++) {
+                float clipped = std::min (1.0f, std::max (-1.0f, samples[i * numLanes + lane] * clipGain));
+                samples[i * numLanes + lane] = std::tanh (clipped * tanhGain);
+            }
+        }
+    }
+
+    template <int numLanes>
+    CHAORUS_INLINE void mixLanesBody (const float* dry, const float* wet, float* out, int numSamples,
+                                      const float* dryAmounts, const float* wetAmounts)
+    {
+        /* Local copies, which the stores to out can't alias */
+        float dryAmount[numLanes];
+        float wetAmount[numLanes];
+
+        for (int lane = 0; lane < numLanes; lane++) {
+            dryAmount[lane] = dryAmounts[lane];
+            wetAmount[lane] = wetAmounts[lane];
+        }
+
+        for (int i = 0; i < numSamples; i++) {
+            for (int lane = 0; lane < numLanes; lane++) {
+                out[i * numLanes + lane] = dry[i * numLanes + lane] * dryAmount[lane] + (wet[i * numLanes + lane] * wetAmount[lane]);
+            }
+        }
+    }
+
+    CHAORUS_INLINE void mixLanesBody (const float* dry, const float* wet, float* out, int numSamples, int numLanes,
+                                      const float* dryAmounts, const float* wetAmounts)
+    {
+        if (numLanes == 16) {
+            mixLanesBody<16> (dry, wet, out, numSamples, dryAmounts, wetAmounts);
+        } else if (numLanes == 8) {
+            mixLanesBody<8> (dry, wet, out, numSamples, dryAmounts, wetAmounts);
+        } else {
+            mixLanesBody<4> (dry, wet, out, numSamples, dryAmounts, wetAmounts);
+        }
+    }
+
+    constexpr int firBlockSize = 32;
+    constexpr int maxFirTaps = 64;
+
+    /* firBlockSize outputs of firSymmetric, which stay in registers across all the taps. The two
+       taps either side of the middle share a multiply. */
+    CHAORUS_INLINE void firSymmetricBlock (const float* input, const float* coefficients, int numTaps, float* out)
+    {
+        float sum[firBlockSize];
+
+        for (int j = 0; j < firBlockSize; j++) {
+            sum[j] = out[j];
+        }
+
+        for (int q = 0; q < numTaps / 2; q++) {
+            const float coefficient = coefficients[q];
+            const float* newer = input - q;
+            const float* older = input - (numTaps - 1 - q);
+
+            for (int j = 0; j < firBlockSize; j++) {
+                sum[j] += coefficient * (newer[j] + older[j]);
+            }
+        }
+
+        for (int j = 0; j < firBlockSize; j++) {
+            out[j] = sum[j];
+        }
+    }
+
+    CHAORUS_INLINE void firSymmetricBody (const float* input, const float* coefficients, int numTaps, float* out, int numSamples)
+    {
+        int i = 0;
+
+        for (; i + firBlockSize <= numSamples; i += firBlockSize) {
+            firSymmetricBlock (input + i, coefficients, numTaps, out + i);
+        }
+
+        /* The rest as a zero padded block, so every output is rounded the same way whatever the
+           block size and the output doesn't depend on it */
+        const int remaining = numSamples - i;
+
+        if (remaining > 0) {
+            float paddedInput[maxFirTaps - 1 + firBlockSize] = {};
+            float paddedOut[firBlockSize] = {};
+
+            std::memcpy (paddedInput, input + i - (numTaps - 1), (size_t) (numTaps - 1 + remaining) * sizeof (float));
+            std::memcpy (paddedOut, out + i, (size_t) remaining * sizeof (float));
+
+            firSymmetricBlock (paddedInput + numTaps - 1, coefficients, numTaps, paddedOut);
+
+            std::memcpy (out + i, paddedOut, (size_t) remaining * sizeof (float));
+        }
+    }
+}
+
+/* Stamps out one full kernel table for an instruction set level */
+#define CHAORUS_DEFINE_KERNELS(suffix, targetAttribute, kernelLevel) \
+    namespace detail \
+    { \
+        targetAttribute inline void lfo_##suffix (float* a, float* b, int n, const float* w, float p, float pi, float po, float d, float mn, float mx) \
+            { lfoBody (a, b, n, w, p, pi, po, d, mn, mx); } \
+        targetAttribute inline void delayRead_##suffix (const float* cb, int len, int wh, const float* dl, const float* dr, float* ol, float* orr, int n) \
+            { delayReadBody (cb, len, wh, dl, dr, ol, orr, n); } \
+        targetAttribute inline void delayReadNearest_##suffix (const float* cb, int len, int wh, const float* dl, const float* dr, float* ol, float* orr, int n) \
+            { delayReadNearestBody (cb, len, wh, dl, dr, ol, orr, n); } \
+        targetAttribute inline void delayReadDual_##suffix (const float* cb, int len, int wh, const float* dla, const float* dra, \
+                                                            const float* dlb, const float* drb, float* ola, float* ora, float* olb, float* orb, int n) \
+            { delayReadDualBody (cb, len, wh, dla, dra, dlb, drb, ola, ora, olb, orb, n); } \
+        targetAttribute inline void saturate_##suffix (float* s, int n, float amount) \
+            { saturateBody (s, n, amount); } \
+        targetAttribute inline void saturateFast_##suffix (float* s, int n, float amount) \
+            { saturateFastBody (s, n, amount); } \
+        targetAttribute inline void mix_##suffix (const float* dl, const float* dr, const float* wl, const float* wr, float* ol, float* orr, \
+                                                  int n, float dryAmount, float wetAmount) \
+            { mixStereoBody (dl, dr, wl, wr, ol, orr, n, dryAmount, wetAmount); } \
+        targetAttribute inline void mixDouble_##suffix (const double* dl, const double* dr, const float* wl, const float* wr, double* ol, double* orr, \
+                                                        int n, float dryAmount, float wetAmount) \
+            { mixStereoBody (dl, dr, wl, wr, ol, orr, n, dryAmount, wetAmount); } \
+        targetAttribute inline void firSymmetric_##suffix (const float* in, const float* c, int taps, float* out, int n) \
+            { firSymmetricBody (in, c, taps, out, n); } \
+        targetAttribute inline void delayReadLanes_##suffix (const float* cb, int len, int wh, int lanes, const float* d, float* o, int n) \
+            { delayReadLanesBody (cb, len, wh, lanes, d, o, n); } \
+        targetAttribute inline void saturateLanes_##suffix (float* s, int n, int lanes, const float* amounts) \
+            { saturateLanesBody (s, n, lanes, amounts); } \
+        targetAttribute inline void mixLanes_##suffix (const float* dry, const float* wet, float* out, int n, int lanes, \
+                                                       const float* dryAmounts, const float* wetAmounts) \
+            { mixLanesBody (dry, wet, out, n, lanes, dryAmounts, wetAmounts); } \
+        \
+        inline const DSPKernels kernels_##suffix { lfo_##suffix, delayRead_##suffix, delayReadNearest_##suffix, delayReadDual_##suffix, \
+                                                   saturate_##suffix, saturateFast_##suffix, \
+                                                   mix_##suffix, mixDouble_##suffix, firSymmetric_##suffix, \
+                                                   delayReadLanes_##suffix, saturateLanes_##suffix, mixLanes_##suffix, kernelLevel }; \
+    }
+
+CHAORUS_DEFINE_KERNELS (baseline, , KernelLevel::Baseline)
+
+#if CHAORUS_MULTIVERSION_KERNELS
+CHAORUS_DEFINE_KERNELS (avx2, CHAORUS_TARGET_AVX2, KernelLevel::AVX2)
+CHAORUS_DEFINE_KERNELS (avx512, CHAORUS_TARGET_AVX512, KernelLevel::AVX512)
+#endif
+
+//==============================================================================
+/* Highest level the running CPU supports */
+inline KernelLevel getSupportedKernelLevel()
+{
+   #if CHAORUS_MULTIVERSION_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vl")
+     && __builtin_cpu_supports ("avx512bw") && __builtin_cpu_supports ("avx512dq")) {
+        return KernelLevel::AVX512;
+    }
+
+    if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+        return KernelLevel::AVX2;
+    }
+   #endif
+
+    return KernelLevel::Baseline;
+}
+
+/* Kernel level to use, which is the supported level unless overridden by the
+   CHAORUSFLANGOS_KERNEL_LEVEL environment variable ("baseline", "sse2", "avx2"
+   or "avx512"). Overrides above what the CPU supports are clamped down. */
+inline KernelLevel getPreferredKernelLevel()
+{
+    /* CPU flags don't change while we're running, so only look them up once per process */
+    static const KernelLevel preferredLevel = [] {
+        KernelLevel supported = getSupportedKernelLevel();
+        KernelLevel level = supported;
+
+        if (const char* forced = std::getenv ("CHAORUSFLANGOS_KERNEL_LEVEL")) {
+            if (std::strcmp (forced, "baseline") == 0 || std::strcmp (forced, "sse2") == 0) {
+                level = KernelLevel::Baseline;
+            } else if (std::strcmp (forced, "avx2") == 0) {
+                level = KernelLevel::AVX2;
+            } else if (std::strcmp (forced, "avx512") == 0) {
+                level = KernelLevel::AVX512;
+            }
+        }
+
+        return std::min (level, supported);
+    }();
+
+    return preferredLevel;
+}
+
+/* Kernels for the requested level, falling back to a lower one if this build doesn't have it */
+inline const DSPKernels& getDSPKernels (KernelLevel level)
+{
+   #if CHAORUS_MULTIVERSION_KERNELS
+    if (level == KernelLevel::AVX512) {
+        return detail::kernels_avx512;
+    }
+
+    if (level == KernelLevel::AVX2) {
+        return detail::kernels_avx2;
+    }
+   #endif
+
+    (void) level;
+    return detail::kernels_baseline;
+}
+
+inline const char* getKernelLevelName (KernelLevel level)
+{
+    switch (level) {
+        case KernelLevel::AVX512:   return "avx512";
+        case KernelLevel::AVX2:     return "avx2";
+        case KernelLevel::Baseline: break;
+    }
+
+    return "baseline";
+}
+
+} // namespace chaorus
@@ -0,0 +1,232 @@
+/*
+  ==============================================================================
+
+    DelayMemory.cpp
+
+  ==============================================================================
+*/
+
+#include "DelayMemory.h"
+
+//==============================================================================
+DelayMemoryAllocator::DelayMemoryAllocator()
+    : juce::Thread("ChaorusFlangos delay memory")
+{
+    for (size_t i = 0; i < queueSize; i++) {
+        mQueue[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+DelayMemoryAllocator::~DelayMemoryAllocator()
+{
+    signalThreadShouldExit();
+    mRequested.signal();
+    stopThread(1000);
+}
+
+void DelayMemoryAllocator::add(DelayMemory& memory)
+{
+    const juce::ScopedLock lock(mLock);
+
+    mInstances.addIfNotAlreadyThere(&memory);
+
+    /* Started on first use rather than with the processor, which has to construct quickly */
+    if (!isThreadRunning()) {
+        startThread(juce::Thread::Priority::background);
+    }
+}
+
+void DelayMemoryAllocator::remove(DelayMemory& memory)
+{
+    const juce::ScopedLock lock(mLock);
+
+    mInstances.removeFirstMatchingValue(&memory);
+}
+
+bool DelayMemoryAllocator::request(DelayMemory& memory)
+{
+    if (!push(&memory)) {
+        return false;
+    }
+
+    mRequested.signal();
+    return true;
+}
+
+void DelayMemoryAllocator::run()
+{
+    while (!threadShouldExit()) {
+        while (DelayMemory* memory = pop()) {
+            const juce::ScopedLock lock(mLock);
+
+            /* Instances can be released with requests still queued, and only the listed ones are alive */
+            if (mInstances.contains(memory)) {
+                memory->serviceRequest();
+            }
+        }
+
+        /* request() signals, the timeout is only a backstop */
+        mRequested.wait(500);
+    }
+}
+
+bool DelayMemoryAllocator::push(DelayMemory* memory)
+{
+    size_t position = mPushPosition.load(std::memory_order_relaxed);
+
+    for (;;) {
+        Cell& cell = mQueue[position % queueSize];
+        const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+
+        if (sequence == position) {
+            /* The cell is free, claim it unless another producer got there first */
+            if (mPushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.memory = memory;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (sequence < position) {
+            /* Still holding a request from a lap ago, the queue is full */
+            return false;
+        } else {
+            position = mPushPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+DelayMemory* DelayMemoryAllocator::pop()
+{
+    const size_t position = mPopPosition.load(std::memory_order_relaxed);
+    Cell& cell = mQueue[position % queueSize];
+
+    if (cell.sequence.load(std::memory_order_acquire) != position + 1) {
+        return nullptr;
+    }
+
+    DelayMemory* memory = cell.memory;
+
+    /* Only this thread pops, and the cell is free again for the push a lap from now */
+    mPopPosition.store(position + 1, std::memory_order_relaxed);
+    cell.sequence.store(position + queueSize, std::memory_order_release);
+
+    return memory;
+}
+
+//==============================================================================
+DelayMemory::DelayMemory()
+{
+}
+
+DelayMemory::~DelayMemory()
+{
+    release();
+    freeAll();
+}
+
+void DelayMemory::prepare(chaorus::State& state, double sampleRate, bool multirate, double delayTime)
+{
+    release();
+    freeAll();
+
+    mSampleRate = sampleRate;
+    mMultirate = multirate;
+
+    mInUse = chaorus::allocateDelayMemory(chaorus::getCircularBufferSize(sampleRate, multirate, delayTime));
+    mInUseDelayTime = delayTime;
+
+    chaorus::prepare(state, sampleRate, mInUse, multirate, delayTime);
+
+    mFramesWritten = 0;
+    mAllocator->add(*this);
+}
+
+void DelayMemory::release()
+{
+    /* Once removed the allocator won't touch this instance again, so what it made can go */
+    mAllocator->remove(*this);
+
+    if (mGrowthStage.exchange(idle) == made) {
+        chaorus::freeDelayMemory(mGrowth.circularBuffer);
+    }
+
+    mGrowth = chaorus::DelayMemoryGrowth();
+
+    chaorus::freeDelayMemory(mRetired.exchange(nullptr));
+}
+
+void DelayMemory::freeAll()
+{
+    chaorus::freeDelayMemory(mInUse);
+    mInUse = nullptr;
+}
+
+void DelayMemory::reserve(chaorus::State& state, double delayTime)
+{
+    if (mInUse == nullptr) {
+        return;
+    }
+
+    delayTime = juce::jmin(delayTime, chaorus::maxDelayTime);
+    mFramesWritten.store(state.framesWritten, std::memory_order_release);
+
+    const int stage = mGrowthStage.load(std::memory_order_acquire);
+
+    if (stage == made) {
+        /* Copies what was written since the allocator last caught up, about a block */
+        mRetired.store(chaorus::setDelayMemory(state, mGrowth), std::memory_order_release);
+        mInUse = mGrowth.circularBuffer;
+        mInUseDelayTime = mGrowthDelayTime;
+
+        mGrowthStage.store(idle, std::memory_order_release);
+
+        /* Have the old memory freed. If the queue is full it goes with the next request. */
+        mAllocator->request(*this);
+    } else if (stage == requested) {
+        if (delayTime > mRequestedDelayTime) {
+            mRequestedDelayTime = delayTime;
+        }
+
+        if (!mRequestQueued) {
+            mRequestQueued = mAllocator->request(*this);
+        }
+    } else if (delayTime > mInUseDelayTime) {
+        mGrowth = chaorus::beginDelayMemoryGrowth(state);
+        mRequestedDelayTime = delayTime;
+        mGrowthStage.store(requested, std::memory_order_release);
+
+        /* If the queue is full, try again on the next block */
+        mRequestQueued = mAllocator->request(*this);
+    }
+}
+
+//==============================================================================
+void DelayMemory::serviceRequest()
+{
+    chaorus::freeDelayMemory(mRetired.exchange(nullptr, std::memory_order_acquire));
+
+    if (mGrowthStage.load(std::memory_order_acquire) != requested) {
+        return;
+    }
+
+    const double delayTime = mRequestedDelayTime;
+
+    /* Zeroed, the frames the history doesn't fill read as silence */
+    float* memory = chaorus::allocateDelayMemory(chaorus::getCircularBufferSize(mSampleRate, mMultirate, delayTime));
+
+    chaorus::copyDelayHistory(mGrowth, memory, delayTime);
+
+    /* The core went on writing during the copy. Catch up until a pass finds no new block, so the
+       core is left with about a block to copy itself. */
+    for (;;) {
+        const juce::int64 framesWritten = mFramesWritten.load(std::memory_order_acquire);
+
+        if (framesWritten <= mGrowth.framesCopied) {
+            break;
+        }
+
+        chaorus::catchUpDelayHistory(mGrowth, framesWritten);
+    }
+
+    mGrowthDelayTime = delayTime;
+    mGrowthStage.store(made, std::memory_order_release);
+}
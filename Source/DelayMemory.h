@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    DelayMemory.h
+
+    The processor's delay memory, sized for the delay range the parameters
+    ask for rather than for the longest one they could. When a longer range
+    needs more, the audio thread queues a request with the one allocator
+    thread all instances in the process share, and wakes it. The allocator
+    makes the memory and copies the history into it while processing goes
+    on, then hands it back through a lock-free slot. Whichever thread runs
+    the core picks it up between blocks and moves the state onto it, copying
+    only the frames written since, and the memory it replaces goes back to
+    the allocator to be freed. The audio thread never allocates, frees,
+    locks or waits.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChaorusCore.h"
+#include "WakeSignal.h"
+
+class DelayMemory;
+
+/* The allocator thread, shared by every DelayMemory through a SharedResourcePointer and only
+   started once one of them is prepared */
+class DelayMemoryAllocator : private juce::Thread
+{
+public:
+    DelayMemoryAllocator();
+    ~DelayMemoryAllocator() override;
+
+    /* Not for the audio thread. Once removed, the allocator no longer touches the instance. */
+    void add(DelayMemory& memory);
+    void remove(DelayMemory& memory);
+
+    /* Real-time safe: queues the instance to be seen to and wakes the allocator. Returns false
+       when the queue is full, for the caller to try again on the next block. */
+    bool request(DelayMemory& memory);
+
+private:
+    void run() override;
+
+    bool push(DelayMemory* memory);
+    DelayMemory* pop();
+
+    /* Bounded lock-free queue of instances with work for the allocator. Any number of audio
+       threads push, the allocator pops. Each cell's sequence says whose turn it is. */
+    static constexpr size_t queueSize = 256;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence { 0 };
+        DelayMemory* memory = nullptr;
+    };
+
+    Cell mQueue[queueSize];
+    std::atomic<size_t> mPushPosition { 0 };
+    std::atomic<size_t> mPopPosition { 0 };
+
+    WakeSignal mRequested;
+
+    /* The prepared instances. The allocator holds the lock while it sees to one, so remove()
+       waits for it to finish. */
+    juce::CriticalSection mLock;
+    juce::Array<DelayMemory*> mInstances;
+
+    JUCE_DECLARE_NON_COPYABLE(DelayMemoryAllocator)
+};
+
+class DelayMemory
+{
+public:
+    DelayMemory();
+    ~DelayMemory();
+
+    /* Frees everything and prepares the state on fresh memory for delays up to delayTime seconds.
+       Not for the audio thread. */
+    void prepare(chaorus::State& state, double sampleRate, bool multirate, double delayTime);
+
+    /* Withdraws from the allocator and frees any memory it was holding for this instance, the
+       state keeps its own. Not for the audio thread. */
+    void release();
+
+    /* Audio thread only, before each block: makes sure the state can reach delayTime seconds
+       back. Asks for more memory when the state's is too short, and moves the state onto it
+       once it has been made. Until then the state holds longer delays to what it has. The state
+       mustn't be reset or seeked between blocks while memory is on its way. */
+    void reserve(chaorus::State& state, double delayTime);
+
+private:
+    friend class DelayMemoryAllocator;
+
+    /* Allocator thread: frees retired memory and makes requested memory */
+    void serviceRequest();
+
+    void freeAll();
+
+    juce::SharedResourcePointer<DelayMemoryAllocator> mAllocator;
+
+    double mSampleRate = 44100.0;
+    bool mMultirate = false;
+
+    /* The memory the state is on and the delay it holds, owned by the thread running the core */
+    float* mInUse = nullptr;
+    double mInUseDelayTime = 0.0;
+
+    /* A growth goes from requested, with mGrowth begun by the core, to made once the allocator
+       has filled in mGrowth, and back to idle when the core takes it. Only the side whose turn it
+       is touches mGrowth. */
+    enum GrowthStage
+    {
+        idle,
+        requested,
+        made
+    };
+
+    std::atomic<int> mGrowthStage { idle };
+    chaorus::DelayMemoryGrowth mGrowth;
+    double mGrowthDelayTime = 0.0;
+
+    /* Longest delay asked for since the growth was requested, for the allocator to make room for */
+    std::atomic<double> mRequestedDelayTime { 0.0 };
+    bool mRequestQueued = false;
+
+    /* state.framesWritten at the start of the latest block, for the allocator to catch up to */
+    std::atomic<juce::int64> mFramesWritten { 0 };
+
+    /* Memory the core has moved off, for the allocator to free */
+    std::atomic<float*> mRetired { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE(DelayMemory)
+};
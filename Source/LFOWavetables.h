@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    LFOWavetables.h
+
+    Band-limited single-cycle LFO shapes, generated at compile time. Every
+    table is an inline constexpr array, so there is one read-only copy per
+    process however many instances are running, and reading one costs an
+    index and a linear interpolation per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace chaorus
+{
+
+enum LFOShape
+{
+    Sine = 0,
+    Triangle,
+    SmoothRandom,
+    Exponential,
+    TapeWow,
+    numLFOShapes
+};
+
+/* Entries per cycle. Every table has one more entry that repeats the first,
+   so interpolating between entries i and i + 1 never has to wrap. */
+constexpr int wavetableSize = 512;
+
+using Wavetable = std::array<float, wavetableSize + 1>;
+
+namespace wavetables
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    constexpr double sin (double x)
+    {
+        /* Reduce to [-pi, pi], then a Taylor series that has converged well below float precision */
+        double turns = x / (2 * pi);
+        x -= 2 * pi * (double) (int64_t) (turns + (turns < 0 ? -0.5 : 0.5));
+
+        double term = x, sum = x;
+        for (int n = 1; n < 16; n++) {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double exp (double x)
+    {
+        /* Halve until small, Taylor series, then square back up */
+        int halvings = 0;
+        while (x > 0.5 || x < -0.5) {
+            x *= 0.5;
+            halvings++;
+        }
+
+        double term = 1, sum = 1;
+        for (int n = 1; n < 16; n++) {
+            term *= x / n;
+            sum += term;
+        }
+
+        for (int i = 0; i < halvings; i++) {
+            sum *= sum;
+        }
+        return sum;
+    }
+
+    /* Phase of table entry i, in radians */
+    constexpr double angle (int i)
+    {
+        return 2 * pi * i / wavetableSize;
+    }
+
+    /* Band-limited triangle from its first eight odd harmonics, peaking at 1 a quarter cycle in */
+    constexpr double bandLimitedTriangle (double x)
+    {
+        double sum = 0;
+        for (int k = 0; k < 8; k++) {
+            const int harmonic = 2 * k + 1;
+            sum += (k % 2 == 0 ? 1.0 : -1.0) * sin (harmonic * x) / (harmonic * harmonic);
+        }
+        return sum;
+    }
+
+    /* Scales the table so its largest magnitude is 1 and fills in the wrap entry */
+    constexpr Wavetable normalise (Wavetable table)
+    {
+        float peak = 0;
+        for (int i = 0; i < wavetableSize; i++) {
+            float magnitude = table[i] < 0 ? -table[i] : table[i];
+            peak = magnitude > peak ? magnitude : peak;
+        }
+
+        for (int i = 0; i < wavetableSize; i++) {
+            table[i] /= peak;
+        }
+
+        table[wavetableSize] = table[0];
+        return table;
+    }
+
+    constexpr Wavetable makeTriangle()
+    {
+        Wavetable table {};
+        for (int i = 0; i < wavetableSize; i++) {
+            table[i] = (float) bandLimitedTriangle (angle (i));
+        }
+        return normalise (table);
+    }
+
+    /* Eight fixed pseudo-random levels per cycle joined by raised-cosine segments */
+    constexpr Wavetable makeSmoothRandom()
+    {
+        constexpr int numPoints = 8;
+
+        double points[numPoints] {};
+        uint32_t seed = 0x2545f491u;
+        for (int p = 0; p < numPoints; p++) {
+            seed = seed * 1664525u + 1013904223u;
+            points[p] = (seed >> 8) / double (1 << 24) * 2 - 1;
+        }
+
+        Wavetable table {};
+        for (int i = 0; i < wavetableSize; i++) {
+            const int segment = i * numPoints / wavetableSize;
+            const double position = (double) (i * numPoints - segment * wavetableSize) / wavetableSize;
+            const double blend = 0.5 - 0.5 * sin (pi * position + pi / 2);
+
+            table[i] = (float) (points[segment] + (points[(segment + 1) % numPoints] - points[segment]) * blend);
+        }
+        return normalise (table);
+    }
+
+    /* Triangle bent through an exponential, so it lingers at the short end and swoops through the long end */
+    constexpr Wavetable makeExponential()
+    {
+        constexpr double curve = 3.0;
+        const double scale = exp (curve) - 1;
+
+        Wavetable table {};
+        for (int i = 0; i < wavetableSize; i++) {
+            double unipolar = 0.5 + 0.5 * bandLimitedTriangle (angle (i)) / bandLimitedTriangle (pi / 2);
+            table[i] = (float) (2 * (exp (curve * unipolar) - 1) / scale - 1);
+        }
+        return normalise (table);
+    }
+
+    /* Slow, lopsided pitch drift of a worn tape transport: a fundamental with a little second and third harmonic */
+    constexpr Wavetable makeTapeWow()
+    {
+        Wavetable table {};
+        for (int i = 0; i < wavetableSize; i++) {
+            const double x = angle (i);
+            table[i] = (float) (sin (x) + 0.3 * sin (2 * x + 0.7) + 0.12 * sin (3 * x + 1.9));
+        }
+        return normalise (table);
+    }
+
+    inline constexpr Wavetable triangle = makeTriangle();
+    inline constexpr Wavetable smoothRandom = makeSmoothRandom();
+    inline constexpr Wavetable exponential = makeExponential();
+    inline constexpr Wavetable tapeWow = makeTapeWow();
+}
+
+/* Table for an LFO shape, or nullptr for the sine which is computed directly */
+inline const float* getWavetable (int shape)
+{
+    switch (shape) {
+        case Triangle:      return wavetables::triangle.data();
+        case SmoothRandom:  return wavetables::smoothRandom.data();
+        case Exponential:   return wavetables::exponential.data();
+        case TapeWow:       return wavetables::tapeWow.data();
+        default:            break;
+    }
+
+    return nullptr;
+}
+
+} // namespace chaorus
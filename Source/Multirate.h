@@ -0,0 +1,268 @@
+/*
+  ==============================================================================
+
+    Multirate.h
+
+    Halfband decimation and interpolation for running the wet path at a
+    reduced rate. A cascade of 2:1 stages brings high sample rates down to a
+    44.1/48 kHz class rate; the last stage, which sets the passband, is the
+    long one and the stages before it only need to keep the band below
+    20 kHz free of aliases. Each stage is split into its two polyphase
+    branches, so only the half of the filter that lands on an output sample
+    is ever computed, and the filters run a block at a time through the
+    firSymmetric kernel.
+
+    Header-only and free of JUCE, like the rest of the DSP core.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DSPKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace chaorus
+{
+
+/* Highest decimation factor, enough to bring 384 kHz down to 48 kHz */
+constexpr int maxDecimation = 8;
+constexpr int maxMultirateStages = 3;
+
+/* Halfband orders: a filter of order K is 4K - 1 taps long, 2K of them on the branch
+   that isn't just the centre tap */
+constexpr int finalHalfbandOrder = 16;
+constexpr int earlyHalfbandOrder = 5;
+
+/* Full-rate frames the multirate path works on at a time */
+constexpr int multirateBlockLength = 512;
+
+/* Decimation factor that brings a sample rate to below 64 kHz */
+inline int getDecimationFactor (double sampleRate)
+{
+    int decimation = 1;
+
+    while (sampleRate / decimation > 64000.0 && decimation < maxDecimation) {
+        decimation *= 2;
+    }
+
+    return decimation;
+}
+
+constexpr int getNumMultirateStages (int decimation)
+{
+    int numStages = 0;
+
+    while ((1 << numStages) < decimation) {
+        numStages++;
+    }
+
+    return numStages;
+}
+
+/* Delay of the decimators, or of the interpolators, in samples at the full rate: each filter
+   delays by half its length at its stage's input rate */
+constexpr int getMultirateFilterDelay (int decimation)
+{
+    const int numStages = getNumMultirateStages (decimation);
+    int delay = 0;
+
+    for (int stage = 0; stage < numStages; stage++) {
+        const int order = stage == numStages - 1 ? finalHalfbandOrder : earlyHalfbandOrder;
+        delay += (2 * order - 1) << stage;
+    }
+
+    return delay;
+}
+
+/* Delay the multirate path adds to the wet signal, in samples at the full rate: both sets of
+   filters, and the decimation - 1 samples the input waits for a whole engine sample. The dry
+   signal is delayed to match. */
+constexpr int getMultirateLatency (int decimation)
+{
+    return 2 * getMultirateFilterDelay (decimation) + decimation - 1;
+}
+
+/* How far behind the wet engine's LFOs run, in samples at the full rate, so they modulate the
+   signal where they would at the full rate: as far as the decimators delay what the engine
+   sees, less the decimation - 1 samples each engine sample waits for its last input */
+constexpr int getMultirateLFOLag (int decimation)
+{
+    return getMultirateFilterDelay (decimation) - (decimation - 1);
+}
+
+constexpr int maxMultirateLatency = getMultirateLatency (maxDecimation);
+
+//==============================================================================
+/* Half the symmetric branch of a Kaiser windowed halfband lowpass, for the decimator and, at
+   twice the gain to make up for the zeros it stuffs, the interpolator. The other branch is the
+   centre tap, 0.5, alone. */
+struct HalfbandCoefficients
+{
+    int order = 0;
+    float decimator[finalHalfbandOrder] = {};
+    float interpolator[finalHalfbandOrder] = {};
+};
+
+namespace detail
+{
+    /* M_PI needs _USE_MATH_DEFINES on MSVC */
+    constexpr double pi = 3.14159265358979323846;
+
+    /* Zeroth order modified Bessel function of the first kind, for the Kaiser window */
+    inline double besselI0 (double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+
+        for (int k = 1; k < 50 && term > 1.0e-12 * sum; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    inline HalfbandCoefficients designHalfband (int order, double beta)
+    {
+        HalfbandCoefficients coefficients;
+        coefficients.order = order;
+
+        const double halfLength = 2 * order - 1;
+        double taps[2 * finalHalfbandOrder];
+        double sum = 0;
+
+        /* Every other tap of the full filter, an odd number of taps from the centre */
+        for (int q = 0; q < 2 * order; q++) {
+            const double offset = 2 * q - halfLength;
+            const double ratio = offset / halfLength;
+            const double window = besselI0 (beta * std::sqrt (std::max (0.0, 1.0 - ratio * ratio))) / besselI0 (beta);
+
+            taps[q] = std::sin (pi * offset / 2) / (pi * offset) * window;
+            sum += taps[q];
+        }
+
+        /* The branch carries half the DC gain and the centre tap the other half */
+        for (int q = 0; q < order; q++) {
+            coefficients.decimator[q] = (float) (taps[q] * 0.5 / sum);
+            coefficients.interpolator[q] = (float) (taps[q] / sum);
+        }
+
+        return coefficients;
+    }
+}
+
+/* The two filters, designed once per process */
+inline const HalfbandCoefficients& getHalfbandCoefficients (bool finalStage)
+{
+    static const HalfbandCoefficients finalCoefficients = detail::designHalfband (finalHalfbandOrder, 7.0);
+    static const HalfbandCoefficients earlyCoefficients = detail::designHalfband (earlyHalfbandOrder, 7.0);
+
+    return finalStage ? finalCoefficients : earlyCoefficients;
+}
+
+//==============================================================================
+/* History of one channel of one 2:1 stage, decimator and interpolator */
+struct HalfbandState
+{
+    float decimatorEven[2 * finalHalfbandOrder - 1] = {};
+    float decimatorOdd[finalHalfbandOrder] = {};
+    float interpolatorInput[2 * finalHalfbandOrder - 1] = {};
+};
+
+/* Everything the multirate path carries between calls */
+struct MultirateState
+{
+    HalfbandState halfbands[maxMultirateStages][2];
+
+    /* Full-rate input short of a whole engine sample */
+    float pendingLeft[maxDecimation] = {};
+    float pendingRight[maxDecimation] = {};
+    int numPending = 0;
+
+    /* Wet signal back at the full rate, and the dry gain for each sample, waiting to be mixed.
+       A negative gain stands for the one the first quantum starts with. */
+    float wetLeft[maxDecimation + multirateBlockLength] = {};
+    float wetRight[maxDecimation + multirateBlockLength] = {};
+    float dryGain[maxDecimation + multirateBlockLength] = {};
+    int numWet = 0;
+
+    /* The last latency samples of dry signal, which the next block's output starts with */
+    double dryLeft[maxMultirateLatency] = {};
+    double dryRight[maxMultirateLatency] = {};
+};
+
+/* Clears the filters and delay. The wet signal starts decimation - 1 samples of silence ahead
+   of the input, so a whole engine sample is always ready by the time its last input is due out. */
+inline void resetMultirate (MultirateState& state, int decimation)
+{
+    state = MultirateState();
+    state.numWet = decimation - 1;
+
+    for (int i = 0; i < state.numWet; i++) {
+        state.dryGain[i] = -1.0f;
+    }
+}
+
+namespace detail
+{
+    /* numOutputs samples from 2 * numOutputs inputs, output may be the same buffer as input */
+    inline void decimate (const DSPKernels& kernels, const HalfbandCoefficients& coefficients, HalfbandState& state,
+                          const float* input, float* output, int numOutputs)
+    {
+        const int order = coefficients.order;
+        const int evenHistory = 2 * order - 1;
+
+        /* Each branch after its own history, so the filter reads one contiguous run */
+        float even[2 * finalHalfbandOrder - 1 + multirateBlockLength / 2];
+        float odd[finalHalfbandOrder + multirateBlockLength / 2];
+
+        std::memcpy (even, state.decimatorEven, (size_t) evenHistory * sizeof (float));
+        std::memcpy (odd, state.decimatorOdd, (size_t) order * sizeof (float));
+
+        for (int m = 0; m < numOutputs; m++) {
+            even[evenHistory + m] = input[2 * m];
+            odd[order + m] = input[2 * m + 1];
+        }
+
+        /* The centre tap falls on the odd branch, order outputs back */
+        for (int m = 0; m < numOutputs; m++) {
+            output[m] = 0.5f * odd[m];
+        }
+
+        kernels.firSymmetric (even + evenHistory, coefficients.decimator, 2 * order, output, numOutputs);
+
+        std::memcpy (state.decimatorEven, even + numOutputs, (size_t) evenHistory * sizeof (float));
+        std::memcpy (state.decimatorOdd, odd + numOutputs, (size_t) order * sizeof (float));
+    }
+
+    /* 2 * numInputs samples from numInputs, output mustn't overlap input */
+    inline void interpolate (const DSPKernels& kernels, const HalfbandCoefficients& coefficients, HalfbandState& state,
+                             const float* input, float* output, int numInputs)
+    {
+        const int order = coefficients.order;
+        const int history = 2 * order - 1;
+
+        float samples[2 * finalHalfbandOrder - 1 + multirateBlockLength / 2];
+        float evenPhase[multirateBlockLength / 2];
+
+        std::memcpy (samples, state.interpolatorInput, (size_t) history * sizeof (float));
+        std::memcpy (samples + history, input, (size_t) numInputs * sizeof (float));
+        std::fill (evenPhase, evenPhase + numInputs, 0.0f);
+
+        kernels.firSymmetric (samples + history, coefficients.interpolator, 2 * order, evenPhase, numInputs);
+
+        /* The odd phase is only the centre tap, at twice 0.5 */
+        for (int m = 0; m < numInputs; m++) {
+            output[2 * m] = evenPhase[m];
+            output[2 * m + 1] = samples[order + m];
+        }
+
+        std::memcpy (state.interpolatorInput, samples + numInputs, (size_t) history * sizeof (float));
+    }
+}
+
+} // namespace chaorus
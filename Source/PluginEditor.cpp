@@ -15,11 +15,7 @@ ChaorusFlangosAudioProcessorEditor::ChaorusFlangosAudioProcessorEditor (ChaorusF
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
-    setSize (800, 150);
-
-    auto& params = processor.getParameters();
-//    std::unique_ptr<CustomLookAndFeel> 
-    customLookAndFeel = std::make_unique<CustomLookAndFeel>();
+    setSize (800, 265);
 
     // Define layout constants
     const int knobSize = 80;
@@ -27,113 +23,70 @@ ChaorusFlangosAudioProcessorEditor::ChaorusFlangosAudioProcessorEditor (ChaorusF
     const int startX = 50;
     const int knobY = 50;
     const int comboY = 80;
+    const int shapeComboY = 40;
     const int comboWidth = 120;
     const int comboHeight = 30;
+    const int toggleY = 115;
+    const int toggleHeight = 25;
+    const int dualKnobY = 165;
+    const int routingComboY = 190;
+    const int routingComboWidth = knobSize;   // one knob wide, so it clears the delay knobs next to it
+
+    /* One knob per knob parameter of the processor, in the same order, left to right */
+    juce::Slider* knobs[] = { &mDryWetSlider, &mDepthSlider, &mRateSlider,
+                              &mPhaseOffsetSlider, &mFeedbackSlider, &mDistortionSlider };
+
+    auto& knobParameters = audioProcessor.getKnobParameters();
+    jassert(knobParameters.size() == juce::numElementsInArray(knobs));
+
+    /* Dual mode's flanger knobs go on a second row, under the chorus knobs they mirror */
+    juce::Slider* dualKnobs[] = { &mFlangerMixSlider, &mFlangerDepthSlider, &mFlangerRateSlider };
+
+    auto& dualKnobParameters = audioProcessor.getDualKnobParameters();
+    jassert(dualKnobParameters.size() == juce::numElementsInArray(dualKnobs));
+
+    /* The delay range knobs share the second row, right of the routing selector, and show in every mode */
+    juce::Slider* delayKnobs[] = { &mBaseDelaySlider, &mDelayRangeSlider };
+
+    auto& delayKnobParameters = audioProcessor.getDelayKnobParameters();
+    jassert(delayKnobParameters.size() == juce::numElementsInArray(delayKnobs));
+
+    auto addKnob = [this] (juce::Slider& slider, juce::AudioParameterFloat* parameter, int x, int y) {
+        slider.setBounds(x, y, knobSize, knobSize);
+        slider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
+        slider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
+        slider.setRange(parameter->range.start, parameter->range.end);
+        slider.setSkewFactor(parameter->range.skew);
+        slider.setValue(*parameter);
+        slider.setLookAndFeel(customLookAndFeel.get());
+        addAndMakeVisible(slider);
+
+        slider.onValueChange = [&slider, parameter] { *parameter = slider.getValue(); };
+        slider.onDragStart = [parameter] { parameter->beginChangeGesture(); };
+        slider.onDragEnd = [parameter] { parameter->endChangeGesture(); };
+    };
+
+    for (int i = 0; i < juce::numElementsInArray(knobs); i++) {
+        addKnob(*knobs[i], knobParameters[i], startX + i * knobSpacing, knobY);
+    }
+
+    for (int i = 0; i < juce::numElementsInArray(dualKnobs); i++) {
+        addKnob(*dualKnobs[i], dualKnobParameters[i], startX + i * knobSpacing, dualKnobY);
+    }
 
-    // Initializing the dry wet slider
-    if (params.size() < 7) return; // Safety check
-    juce::AudioParameterFloat* dryWetParameter = dynamic_cast<juce::AudioParameterFloat*>(params.getUnchecked(0));
-    if (!dryWetParameter) return;
-
-    mDryWetSlider.setBounds(startX, knobY, knobSize, knobSize);
-    mDryWetSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mDryWetSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mDryWetSlider.setRange(dryWetParameter->range.start, dryWetParameter->range.end);
-    mDryWetSlider.setValue(*dryWetParameter);
-    mDryWetSlider.setLookAndFeel(customLookAndFeel.get());
-    addAndMakeVisible(mDryWetSlider);
-
-    mDryWetSlider.onValueChange = [this, dryWetParameter] { *dryWetParameter = mDryWetSlider.getValue(); };
-    mDryWetSlider.onDragStart = [dryWetParameter] { dryWetParameter->beginChangeGesture(); };
-    mDryWetSlider.onDragEnd = [dryWetParameter] { dryWetParameter->endChangeGesture(); };
-
-    // Initializing the depth slider
-    juce::AudioParameterFloat* depthParameter = dynamic_cast<juce::AudioParameterFloat*>(params.getUnchecked(1));
-    if (!depthParameter) return;
-
-    mDepthSlider.setBounds(startX + knobSpacing, knobY, knobSize, knobSize);
-    mDepthSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mDepthSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mDepthSlider.setRange(depthParameter->range.start, depthParameter->range.end);
-    mDepthSlider.setValue(*depthParameter);
-    mDepthSlider.setLookAndFeel(customLookAndFeel.get());
-    addAndMakeVisible(mDepthSlider);
-
-    mDepthSlider.onValueChange = [this, depthParameter] { *depthParameter = mDepthSlider.getValue(); };
-    mDepthSlider.onDragStart = [depthParameter] { depthParameter->beginChangeGesture(); };
-    mDepthSlider.onDragEnd = [depthParameter] { depthParameter->endChangeGesture(); };
-
-    // Initializing the rate slider
-    juce::AudioParameterFloat* rateParameter = dynamic_cast<juce::AudioParameterFloat*>(params.getUnchecked(2));
-    if (!rateParameter) return;
-
-    mRateSlider.setBounds(startX + 2 * knobSpacing, knobY, knobSize, knobSize);
-    mRateSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mRateSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mRateSlider.setRange(rateParameter->range.start, rateParameter->range.end);
-    mRateSlider.setValue(*rateParameter);
-    mRateSlider.setLookAndFeel(customLookAndFeel.get());
-    addAndMakeVisible(mRateSlider);
-
-    mRateSlider.onValueChange = [this, rateParameter] { *rateParameter = mRateSlider.getValue(); };
-    mRateSlider.onDragStart = [rateParameter] { rateParameter->beginChangeGesture(); };
-    mRateSlider.onDragEnd = [rateParameter] { rateParameter->endChangeGesture(); };
-
-    // Initializing the phase slider
-    juce::AudioParameterFloat* phaseParameter = dynamic_cast<juce::AudioParameterFloat*>(params.getUnchecked(3));
-    if (!phaseParameter) return;
-
-    mPhaseOffsetSlider.setBounds(startX + 3 * knobSpacing, knobY, knobSize, knobSize);
-    mPhaseOffsetSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mPhaseOffsetSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mPhaseOffsetSlider.setRange(phaseParameter->range.start, phaseParameter->range.end);
-    mPhaseOffsetSlider.setValue(*phaseParameter);
-    mPhaseOffsetSlider.setLookAndFeel(customLookAndFeel.get());
-    addAndMakeVisible(mPhaseOffsetSlider);
-
-    mPhaseOffsetSlider.onValueChange = [this, phaseParameter] { *phaseParameter = mPhaseOffsetSlider.getValue(); };
-    mPhaseOffsetSlider.onDragStart = [phaseParameter] { phaseParameter->beginChangeGesture(); };
-    mPhaseOffsetSlider.onDragEnd = [phaseParameter] { phaseParameter->endChangeGesture(); };
-
-    // Initializing the feedback slider
-    juce::AudioParameterFloat* feedbackParameter = dynamic_cast<juce::AudioParameterFloat*>(params.getUnchecked(4));
-    if (!feedbackParameter) return;
-    mFeedbackSlider.setBounds(startX + 4 * knobSpacing, knobY, knobSize, knobSize);
-    mFeedbackSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mFeedbackSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mFeedbackSlider.setRange(feedbackParameter->range.start, feedbackParameter->range.end);
-    mFeedbackSlider.setValue(*feedbackParameter);
-    mFeedbackSlider.setLookAndFeel(customLookAndFeel.get());
-    addAndMakeVisible(mFeedbackSlider);
-
-    mFeedbackSlider.onValueChange = [this, feedbackParameter] { *feedbackParameter = mFeedbackSlider.getValue(); };
-    mFeedbackSlider.onDragStart = [feedbackParameter] { feedbackParameter->beginChangeGesture(); };
-    mFeedbackSlider.onDragEnd = [feedbackParameter] { feedbackParameter->endChangeGesture(); };
-
-    // Initializing the distortion slider
-    juce::AudioParameterFloat* distortionParameter = dynamic_cast<juce::AudioParameterFloat*>(params.getUnchecked(5));
-    if (!distortionParameter) return;
-    mDistortionSlider.setBounds(startX + 5 * knobSpacing, knobY, knobSize, knobSize);
-    mDistortionSlider.setSliderStyle(juce::Slider::SliderStyle::RotaryVerticalDrag);
-    mDistortionSlider.setTextBoxStyle(juce::Slider::TextEntryBoxPosition::NoTextBox, true, 0, 0);
-    mDistortionSlider.setRange(distortionParameter->range.start, distortionParameter->range.end);
-    mDistortionSlider.setValue(*distortionParameter);
-    mDistortionSlider.setLookAndFeel(customLookAndFeel.get());
-    addAndMakeVisible(mDistortionSlider);
-
-    mDistortionSlider.onValueChange = [this, distortionParameter] { *distortionParameter = mDistortionSlider.getValue(); };
-    mDistortionSlider.onDragStart = [distortionParameter] { distortionParameter->beginChangeGesture(); };
-    mDistortionSlider.onDragEnd = [distortionParameter] { distortionParameter->endChangeGesture(); };
+    for (int i = 0; i < juce::numElementsInArray(delayKnobs); i++) {
+        addKnob(*delayKnobs[i], delayKnobParameters[i], startX + (4 + i) * knobSpacing, dualKnobY);
+    }
 
     // Type selector
-    juce::AudioParameterInt* typeParameter = dynamic_cast<juce::AudioParameterInt*>(params.getUnchecked(6));
-    if (!typeParameter) return;
+    juce::AudioParameterInt* typeParameter = audioProcessor.getTypeParameter();
 
     mType.setBounds(startX + 6 * knobSpacing, comboY, comboWidth, comboHeight);
     mType.setColour(juce::ComboBox::backgroundColourId, juce::Colours::brown);
     mType.addItem("Jello", 1);
     mType.addItem("Wavy", 2);
     mType.addItem("Tormentrix", 3);
+    mType.addItem("Dual", 4);
     addAndMakeVisible(mType);
 
     mType.onChange = [this, typeParameter] {
@@ -141,13 +94,98 @@ ChaorusFlangosAudioProcessorEditor::ChaorusFlangosAudioProcessorEditor (ChaorusF
         *typeParameter = mType.getSelectedItemIndex();
         typeParameter->endChangeGesture();
         updateDistortionKnobVisibility();
+        updateDualControlsVisibility();
     };
 
     mType.setSelectedItemIndex(*typeParameter);
     mType.setLookAndFeel(customLookAndFeel.get());
+
+    // LFO shape selector
+    juce::AudioParameterInt* shapeParameter = audioProcessor.getShapeParameter();
+
+    mShape.setBounds(startX + 6 * knobSpacing, shapeComboY, comboWidth, comboHeight);
+    mShape.setColour(juce::ComboBox::backgroundColourId, juce::Colours::brown);
+    mShape.addItem("Sine", 1);
+    mShape.addItem("Triangle", 2);
+    mShape.addItem("Random", 3);
+    mShape.addItem("Exponential", 4);
+    mShape.addItem("Tape Wow", 5);
+    addAndMakeVisible(mShape);
+
+    mShape.onChange = [this, shapeParameter] {
+        shapeParameter->beginChangeGesture();
+        *shapeParameter = mShape.getSelectedItemIndex();
+        shapeParameter->endChangeGesture();
+    };
+
+    mShape.setSelectedItemIndex(*shapeParameter);
+    mShape.setLookAndFeel(customLookAndFeel.get());
+
+    // Dual mode routing selector
+    juce::AudioParameterInt* routingParameter = audioProcessor.getRoutingParameter();
+
+    mRouting.setBounds(startX + 3 * knobSpacing, routingComboY, routingComboWidth, comboHeight);
+    mRouting.setColour(juce::ComboBox::backgroundColourId, juce::Colours::brown);
+    mRouting.addItem("Parallel", 1);
+    mRouting.addItem("Serial", 2);
+    addAndMakeVisible(mRouting);
+
+    mRouting.onChange = [this, routingParameter] {
+        routingParameter->beginChangeGesture();
+        *routingParameter = mRouting.getSelectedItemIndex();
+        routingParameter->endChangeGesture();
+    };
+
+    mRouting.setSelectedItemIndex(*routingParameter);
+    mRouting.setLookAndFeel(customLookAndFeel.get());
+
+    // Adaptive quality switch
+    mAdaptiveQuality.setButtonText("Adaptive CPU");
+    mAdaptiveQuality.setBounds(startX + 6 * knobSpacing, toggleY, comboWidth, toggleHeight);
+    mAdaptiveQuality.setToggleState(audioProcessor.getAdaptiveQuality(), juce::dontSendNotification);
+    mAdaptiveQuality.setLookAndFeel(customLookAndFeel.get());
+    addAndMakeVisible(mAdaptiveQuality);
+
+    mAdaptiveQuality.onClick = [this] {
+        audioProcessor.setAdaptiveQuality(mAdaptiveQuality.getToggleState());
+    };
+
+    // Pipelined mode switch, applies when the host next prepares the plugin
+    mPipelined.setButtonText("Pipelined");
+    mPipelined.setBounds(startX + 6 * knobSpacing, toggleY + toggleHeight, comboWidth, toggleHeight);
+    mPipelined.setToggleState(audioProcessor.getPipelined(), juce::dontSendNotification);
+    mPipelined.setLookAndFeel(customLookAndFeel.get());
+    addAndMakeVisible(mPipelined);
+
+    mPipelined.onClick = [this] {
+        audioProcessor.setPipelined(mPipelined.getToggleState());
+    };
+
+    // Multirate mode switch, also applies when the host next prepares the plugin
+    mMultirate.setButtonText("Multirate");
+    mMultirate.setBounds(startX + 6 * knobSpacing, toggleY + 2 * toggleHeight, comboWidth, toggleHeight);
+    mMultirate.setToggleState(audioProcessor.getMultirate(), juce::dontSendNotification);
+    mMultirate.setLookAndFeel(customLookAndFeel.get());
+    addAndMakeVisible(mMultirate);
+
+    mMultirate.onClick = [this] {
+        audioProcessor.setMultirate(mMultirate.getToggleState());
+    };
+
+    // Transport lock switch, the LFOs follow the host's play position
+    mTransportLocked.setButtonText("Transport LFO");
+    mTransportLocked.setBounds(startX + 6 * knobSpacing, toggleY + 3 * toggleHeight, comboWidth, toggleHeight);
+    mTransportLocked.setToggleState(audioProcessor.getTransportLocked(), juce::dontSendNotification);
+    mTransportLocked.setLookAndFeel(customLookAndFeel.get());
+    addAndMakeVisible(mTransportLocked);
+
+    mTransportLocked.onClick = [this] {
+        audioProcessor.setTransportLocked(mTransportLocked.getToggleState());
+    };
     
-    // Set initial visibility of distortion knob
+    // Set initial visibility of distortion knob and dual mode controls
     updateDistortionKnobVisibility();
+    updateDualControlsVisibility();
 }
 
 ChaorusFlangosAudioProcessorEditor::~ChaorusFlangosAudioProcessorEditor()
@@ -157,20 +195,28 @@ ChaorusFlangosAudioProcessorEditor::~ChaorusFlangosAudioProcessorEditor()
 //==============================================================================
 void ChaorusFlangosAudioProcessorEditor::paint (juce::Graphics& g)
 {
-    // Create a gradient background
-    juce::ColourGradient gradient(juce::Colour(0xff2c2c2c), 0, 0,
-                                  juce::Colour(0xff1a1a1a), 0, getHeight(), false);
-    g.setGradientFill(gradient);
-    g.fillAll();
-    
-    // Add a subtle border
-    g.setColour(juce::Colour(0xff404040));
-    g.drawRect(getLocalBounds(), 1);
-    
-    // Add plugin title
-    g.setColour(juce::Colours::white);
-    g.setFont(juce::Font(20.0f, juce::Font::bold));
-    g.drawText("?", 0, 5, getWidth(), 20, juce::Justification::centred);
+    /* The background never changes, so it is only drawn once it is first needed */
+    if (!mBackground.isValid() || mBackground.getWidth() != getWidth() || mBackground.getHeight() != getHeight()) {
+        mBackground = juce::Image(juce::Image::RGB, getWidth(), getHeight(), false);
+        juce::Graphics bg(mBackground);
+
+        // Create a gradient background
+        juce::ColourGradient gradient(juce::Colour(0xff2c2c2c), 0, 0,
+                                      juce::Colour(0xff1a1a1a), 0, getHeight(), false);
+        bg.setGradientFill(gradient);
+        bg.fillAll();
+
+        // Add a subtle border
+        bg.setColour(juce::Colour(0xff404040));
+        bg.drawRect(getLocalBounds(), 1);
+
+        // Add plugin title
+        bg.setColour(juce::Colours::white);
+        bg.setFont(juce::Font(20.0f, juce::Font::bold));
+        bg.drawText("?", 0, 5, getWidth(), 20, juce::Justification::centred);
+    }
+
+    g.drawImageAt(mBackground, 0, 0);
 }
 
 void ChaorusFlangosAudioProcessorEditor::resized()
@@ -186,3 +232,13 @@ void ChaorusFlangosAudioProcessorEditor::updateDistortionKnobVisibility()
     mDistortionSlider.setVisible(showDistortion);
 }
 
+void ChaorusFlangosAudioProcessorEditor::updateDualControlsVisibility()
+{
+    // Show the flanger engine's controls only for Dual mode (index 3)
+    bool showDual = (mType.getSelectedItemIndex() == 3);
+    mFlangerMixSlider.setVisible(showDual);
+    mFlangerDepthSlider.setVisible(showDual);
+    mFlangerRateSlider.setVisible(showDual);
+    mRouting.setVisible(showDual);
+}
+
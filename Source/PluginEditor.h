@@ -22,6 +22,10 @@ public:
     {
         // Set default background color for the ComboBox
         setColour(juce::ComboBox::backgroundColourId, juce::Colours::brown);
+
+        setColour(juce::Slider::thumbColourId, juce::Colours::ivory);
+        setColour(juce::Slider::rotarySliderFillColourId, juce::Colours::brown);
+        setColour(juce::Slider::rotarySliderOutlineColourId, juce::Colours::antiquewhite);
     }
 
     void drawPopupMenuItem(juce::Graphics& g, const juce::Rectangle<int>& area, const bool isSeparator, const bool isActive, const bool isHighlighted, const bool isTicked, const bool hasSubMenu, const juce::String& text, const juce::String& shortcutKeyText, const juce::Drawable* icon, const juce::Colour* const textColourToUse) override 
@@ -35,15 +39,6 @@ public:
         LookAndFeel_V4::drawPopupMenuItem(g, area, isSeparator, isActive, isHighlighted, isTicked, hasSubMenu, text, shortcutKeyText, icon, textColourToUse);
     }
 
-    void drawRotarySlider(juce::Graphics& g, int x, int y, int width, int height, float sliderPos,
-                          float rotaryStartAngle, float rotaryEndAngle, juce::Slider& slider) override 
-    {
-        setColour(juce::Slider::thumbColourId, juce::Colours::ivory);
-        setColour(juce::Slider::rotarySliderFillColourId, juce::Colours::brown);
-        setColour(juce::Slider::rotarySliderOutlineColourId, juce::Colours::antiquewhite);
-
-        LookAndFeel_V4::drawRotarySlider(g, x, y, width, height, sliderPos, rotaryStartAngle, rotaryEndAngle, slider);
-    }
 };
 
 // -----
@@ -59,22 +54,38 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
     void updateDistortionKnobVisibility();
+    void updateDualControlsVisibility();
 
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     ChaorusFlangosAudioProcessor& audioProcessor;
 
+    /* One look and feel shared by every open editor, created when the first one opens.
+       Declared before the controls so it outlives them. */
+    juce::SharedResourcePointer<CustomLookAndFeel> customLookAndFeel;
+
+    /* Background drawn on the first paint and reused until the size changes */
+    juce::Image mBackground;
+
     juce::Slider mDryWetSlider;
     juce::Slider mDepthSlider;
     juce::Slider mRateSlider;
     juce::Slider mPhaseOffsetSlider;
     juce::Slider mFeedbackSlider;
     juce::Slider mDistortionSlider;
+    juce::Slider mFlangerMixSlider;
+    juce::Slider mFlangerDepthSlider;
+    juce::Slider mFlangerRateSlider;
+    juce::Slider mBaseDelaySlider;
+    juce::Slider mDelayRangeSlider;
     juce::ComboBox mType;
-
-    std::unique_ptr<CustomLookAndFeel> customLookAndFeel;
-//    CustomLookAndFeel customLookAndFeel;
+    juce::ComboBox mShape;
+    juce::ComboBox mRouting;
+    juce::ToggleButton mAdaptiveQuality;
+    juce::ToggleButton mPipelined;
+    juce::ToggleButton mMultirate;
+    juce::ToggleButton mTransportLocked;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChaorusFlangosAudioProcessorEditor)
 };
@@ -9,6 +9,28 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    /* Ranges of the float parameters, which parseCoreParameters() holds state values to like
+       the parameters do */
+    const juce::NormalisableRange<float> dryWetRange(0.0f, 1.0f);
+    const juce::NormalisableRange<float> depthRange(0.0f, 1.0f);
+    const juce::NormalisableRange<float> rateRange(0.1f, 20.0f);
+    const juce::NormalisableRange<float> phaseOffsetRange(0.0f, 1.0f);
+    const juce::NormalisableRange<float> feedbackRange(0.0f, 0.98f);
+    const juce::NormalisableRange<float> distortionRange(0.0f, 1.0f);
+    const juce::NormalisableRange<float> flangerDepthRange(0.0f, 1.0f);
+    const juce::NormalisableRange<float> flangerRateRange(0.05f, 5.0f);
+    const juce::NormalisableRange<float> flangerMixRange(0.0f, 1.0f);
+    const juce::NormalisableRange<float> baseDelayRange(0.0f, chaorus::maxBaseDelay * 1000.0f, 0.0f, 0.3f);
+    const juce::NormalisableRange<float> delayRangeRange(0.0f, chaorus::maxDelayRange * 1000.0f, 0.0f, 0.3f);
+
+    /* Delay range a new processor starts on, in milliseconds */
+    constexpr float defaultDelayRange = 25.0f;
+
+    std::atomic<int> numConstructed { 0 };
+}
+
 //==============================================================================
 ChaorusFlangosAudioProcessor::ChaorusFlangosAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -22,41 +44,33 @@ ChaorusFlangosAudioProcessor::ChaorusFlangosAudioProcessor()
                        )
 #endif
 {
-    /* Construct and add parameters */
-    addParameter(mDryWetParameter = new juce::AudioParameterFloat(juce::ParameterID{"dry wet", 1}, "Dry Wet", 0.0, 1.0, 0.5));
-    addParameter(mDepthParameter = new juce::AudioParameterFloat(juce::ParameterID{"depth", 2}, "Depth", 0.0, 1.0, 0.5));
-    addParameter(mRateParameter = new juce::AudioParameterFloat(juce::ParameterID{"rate", 3}, "Rate", 0.1f, 20.f, 10.f));
-    addParameter(mPhaseOffsetParameter = new juce::AudioParameterFloat(juce::ParameterID{"phaseoffset", 4}, "Phase Offset", 0.0f, 1.f, 0.f));
-    addParameter(mFeedbackParameter = new juce::AudioParameterFloat(juce::ParameterID{"feedback", 5}, "Feedback", 0.0, 0.98, 0.5));
-    addParameter(mDistortionParameter = new juce::AudioParameterFloat(juce::ParameterID{"distortion", 6}, "Distortion", 0.0, 1.0, 0.0));
-    addParameter(mTypeParameter = new juce::AudioParameterInt(juce::ParameterID{"type", 7}, "Type", 0, 2, 0));
+    numConstructed++;
 
-
-    /* Initialize our data to default values */
-    mCircularBufferLeft = nullptr;
-    delete [] mCircularBufferLeft;
-    mCircularBufferRight = nullptr;
-    delete [] mCircularBufferRight;
-
-    mCircularBufferWriteHead = 0;
-    mCircularBufferLength = 0;
-
-    mFeedbackLeft = 0;
-    mFeedbackRight = 0;
-    mLFOPhase = 0;
+    /* Construct and add parameters */
+    addParameter(mDryWetParameter = new juce::AudioParameterFloat(juce::ParameterID{"dry wet", 1}, "Dry Wet", dryWetRange, 0.5f));
+    addParameter(mDepthParameter = new juce::AudioParameterFloat(juce::ParameterID{"depth", 2}, "Depth", depthRange, 0.5f));
+    addParameter(mRateParameter = new juce::AudioParameterFloat(juce::ParameterID{"rate", 3}, "Rate", rateRange, 10.f));
+    addParameter(mPhaseOffsetParameter = new juce::AudioParameterFloat(juce::ParameterID{"phaseoffset", 4}, "Phase Offset", phaseOffsetRange, 0.f));
+    addParameter(mFeedbackParameter = new juce::AudioParameterFloat(juce::ParameterID{"feedback", 5}, "Feedback", feedbackRange, 0.5f));
+    addParameter(mDistortionParameter = new juce::AudioParameterFloat(juce::ParameterID{"distortion", 6}, "Distortion", distortionRange, 0.0f));
+    addParameter(mTypeParameter = new juce::AudioParameterInt(juce::ParameterID{"type", 7}, "Type", 0, chaorus::Dual, 0));
+    addParameter(mShapeParameter = new juce::AudioParameterInt(juce::ParameterID{"shape", 8}, "Shape", 0, chaorus::numLFOShapes - 1, chaorus::Sine));
+    addParameter(mFlangerDepthParameter = new juce::AudioParameterFloat(juce::ParameterID{"flanger depth", 9}, "Flanger Depth", flangerDepthRange, 0.5f));
+    addParameter(mFlangerRateParameter = new juce::AudioParameterFloat(juce::ParameterID{"flanger rate", 10}, "Flanger Rate", flangerRateRange, 0.5f));
+    addParameter(mFlangerMixParameter = new juce::AudioParameterFloat(juce::ParameterID{"flanger mix", 11}, "Flanger Mix", flangerMixRange, 0.5f));
+    addParameter(mRoutingParameter = new juce::AudioParameterInt(juce::ParameterID{"routing", 12}, "Routing", 0, chaorus::Serial, chaorus::Parallel));
+    addParameter(mBaseDelayParameter = new juce::AudioParameterFloat(juce::ParameterID{"base delay", 13}, "Base Delay", baseDelayRange, 0.0f));
+    addParameter(mDelayRangeParameter = new juce::AudioParameterFloat(juce::ParameterID{"delay range", 14}, "Delay Range", delayRangeRange, defaultDelayRange));
+
+    mKnobParameters.addArray({ mDryWetParameter, mDepthParameter, mRateParameter,
+                               mPhaseOffsetParameter, mFeedbackParameter, mDistortionParameter });
+    mDualKnobParameters.addArray({ mFlangerMixParameter, mFlangerDepthParameter, mFlangerRateParameter });
+    mDelayKnobParameters.addArray({ mBaseDelayParameter, mDelayRangeParameter });
 }
 
 ChaorusFlangosAudioProcessor::~ChaorusFlangosAudioProcessor()
 {
-    if (mCircularBufferLeft != nullptr) {
-        delete [] mCircularBufferLeft;
-        mCircularBufferLeft = nullptr;
-    }
-
-    if (mCircularBufferRight != nullptr) {
-        delete [] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
-    }
+    mPipeline.release();
 }
 
 //==============================================================================
@@ -94,7 +108,11 @@ bool ChaorusFlangosAudioProcessor::isMidiEffect() const
 
 double ChaorusFlangosAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    /* How long the feedback takes to die away 60 dB at the current delay range, the same
+       decay the offline pre-roll works out */
+    const double sampleRate = getSampleRate() > 0 ? getSampleRate() : 44100.0;
+
+    return chaorus::getPreRollSamples(getCoreParameters(), sampleRate, -60.0f) / sampleRate;
 }
 
 int ChaorusFlangosAudioProcessor::getNumPrograms()
@@ -125,39 +143,25 @@ void ChaorusFlangosAudioProcessor::changeProgramName (int index, const juce::Str
 void ChaorusFlangosAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     /* Initialize data for the current sample rate and reset things such as phase and writeheads */
-    mLFOPhase = 0;
-    mCircularBufferLength = sampleRate * MAX_DELAY_TIME;
+    mPipeline.release();
 
-    // Clearing the buffer shit
-    if (mCircularBufferLeft != nullptr ) {
-        delete [] mCircularBufferLeft;
-        mCircularBufferLeft = nullptr;
-    }
-
-    if (mCircularBufferRight != nullptr ) {
-        delete [] mCircularBufferRight;
-        mCircularBufferRight = nullptr;
-    }
+    /* Only as much delay memory as the current delay range needs, more comes when it grows */
+    mDelayMemory.prepare(mState, sampleRate, mMultirateRequested, chaorus::getDelayMemoryTime(getCoreParameters()));
+    mQualityGovernor.reset();
 
-    if (mCircularBufferLeft == nullptr) {
-        mCircularBufferLeft = new float[mCircularBufferLength];
+    if (mPipelinedRequested) {
+        mPipeline.prepare(getTotalNumOutputChannels(), samplesPerBlock);
     }
 
-    juce::zeromem(mCircularBufferLeft, mCircularBufferLength * sizeof(float));
-
-    if (mCircularBufferRight == nullptr) {
-        mCircularBufferRight = new float[mCircularBufferLength];
-    }
-
-    juce::zeromem(mCircularBufferRight, mCircularBufferLength * sizeof(float));
-
-    mCircularBufferWriteHead = 0;
+    setLatencySamples(mPipeline.getLatencySamples() + chaorus::getLatencySamples(mState));
 }
 
 void ChaorusFlangosAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    mPipeline.release();
+    mDelayMemory.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -182,142 +186,83 @@ bool ChaorusFlangosAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
 #endif
 
 void ChaorusFlangosAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer);
+}
+
+void ChaorusFlangosAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer);
+}
+
+bool ChaorusFlangosAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void ChaorusFlangosAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
+    chaorus::ScopedRealtimeSection realtimeSection;
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    /* Obtain the left and right audio data pointers */
-    float* leftChannel = buffer.getWritePointer(0);
-    float* rightChannel = buffer.getWritePointer(1);
-
-    /* Iterate through all the samples in the buffer */
-    for (int i = 0; i < buffer.getNumSamples(); i++) {
-        /* Write into the circular buffer */
-        mCircularBufferLeft[mCircularBufferWriteHead] = leftChannel[i] + mFeedbackLeft;
-        mCircularBufferRight[mCircularBufferWriteHead] = rightChannel[i] + mFeedbackRight;
+    /* Where this block sits on the host's timeline, for the LFOs to lock to. A stopped
+       transport reports the same position every block, which would hold the LFOs still. */
+    juce::Optional<juce::int64> timelinePosition;
 
-        /* Generate the left LFO output */
-        float lfoOutLeft = sin(2*M_PI * mLFOPhase);
-
-        /* Calculate the right channel lfo phase */
-        float lfoPhaseRight = mLFOPhase + *mPhaseOffsetParameter;
-        if (lfoPhaseRight > 1) {
-            lfoPhaseRight -= 1;
-        }
-
-        /* Generate right LFO output */
-        float lfoOutRight = sin(2*M_PI * lfoPhaseRight);
-
-        /* Moving LFO phase forward */
-        mLFOPhase += *mRateParameter / getSampleRate();
-
-        if (mLFOPhase > 1) {
-            mLFOPhase -= 1;
-        }
-
-        /* Control the LFO Depth */
-        lfoOutLeft *= *mDepthParameter;
-        lfoOutRight *= *mDepthParameter;
-
-        float lfoOutMappedLeft = 0;
-        float lfoOutMappedRight = 0;
-
-
-        /* Map the LFO output to the delay times */
-        // chorus
-        if(*mTypeParameter == 0) {
-            lfoOutMappedLeft = juce::jmap(lfoOutLeft, -1.f, 1.f, 0.005f, 0.03f);
-            lfoOutMappedRight = juce::jmap(lfoOutRight, -1.f, 1.f, 0.005f, 0.03f);
-
-        // flanger
-        } else if(*mTypeParameter == 1) {
-            lfoOutMappedLeft = juce::jmap(lfoOutLeft, -1.f, 1.f, 0.001f, 0.005f);
-            lfoOutMappedRight = juce::jmap(lfoOutRight, -1.f, 1.f, 0.001f, 0.005f);
-        }
-        // tormentrix - same as flanger but with distortion
-        else {
-            lfoOutMappedLeft = juce::jmap(lfoOutLeft, -1.f, 1.f, 0.001f, 0.005f);
-            lfoOutMappedRight = juce::jmap(lfoOutRight, -1.f, 1.f, 0.001f, 0.005f);
-        }
-
-        /* Calculate the delay lenghts in samples */
-        float delayTimeSamplesLeft = getSampleRate() * lfoOutMappedLeft;
-        float delayTimeSamplesRight = getSampleRate() * lfoOutMappedRight;
-
-
-
-        /* Calculate the left read head position */
-        float delayReadHeadLeft = mCircularBufferWriteHead - delayTimeSamplesLeft;
-        if (delayReadHeadLeft < 0) {
-            delayReadHeadLeft += mCircularBufferLength;
-        }
-
-        /* Calculate the right read head position */
-        float delayReadHeadRight = mCircularBufferWriteHead - delayTimeSamplesRight;
-        if (delayReadHeadRight < 0) {
-            delayReadHeadRight += mCircularBufferLength;
-        }
-
-        /* Calculate linear interpolation points for left channel */
-        int readHeadLeft_x = (int)delayReadHeadLeft;
-        int readHeadLeft_x1 = readHeadLeft_x + 1;
-        float readHeadFloatLeft = delayReadHeadLeft - readHeadLeft_x;
-
-        if (readHeadLeft_x1 >= mCircularBufferLength) {
-            readHeadLeft_x1 -= mCircularBufferLength;
+    if (mTransportLocked) {
+        if (auto* playHead = getPlayHead()) {
+            if (auto position = playHead->getPosition()) {
+                if (position->getIsPlaying()) {
+                    timelinePosition = position->getTimeInSamples();
+                }
+            }
         }
+    }
 
-        /* Calculate linear interpolation points for right channel */
-        int readHeadRight_x = (int)delayReadHeadRight;
-        int readHeadRight_x1 = readHeadRight_x + 1;
-        float readHeadFloatRight = delayReadHeadRight - readHeadRight_x;
-
-        if (readHeadRight_x1 >= mCircularBufferLength) {
-            readHeadRight_x1 -= mCircularBufferLength;
-        }
+    if (mPipeline.isActive()) {
+        mPipeline.process(buffer, timelinePosition);
+    } else {
+        processCore(buffer.getArrayOfWritePointers(), totalNumOutputChannels, buffer.getNumSamples(), timelinePosition);
+    }
+}
 
+template <typename SampleType>
+void ChaorusFlangosAudioProcessor::processCore (SampleType* const* channels, int numChannels, int numSamples,
+                                                juce::Optional<juce::int64> timelinePosition)
+{
+    /* Offline renders have no deadline to meet and run at full quality, so they come out the same every time */
+    const bool adaptiveQuality = mAdaptiveQuality.load() && !isNonRealtime();
+    const juce::int64 startTicks = adaptiveQuality ? juce::Time::getHighResolutionTicks() : 0;
 
-        /* generate the actual samples */
-        float delay_sample_left = lin_interp(mCircularBufferLeft[readHeadLeft_x],
-                                             mCircularBufferLeft[readHeadLeft_x1],
-                                             readHeadFloatLeft);
-        float delay_sample_right = lin_interp(mCircularBufferRight[readHeadRight_x],
-                                              mCircularBufferRight[readHeadRight_x1],
-                                              readHeadFloatRight);
-
-        mFeedbackLeft = delay_sample_left * *mFeedbackParameter;
-        mFeedbackRight = delay_sample_right * *mFeedbackParameter;
-
-        // Apply distortion for Tormentrix mode
-        if(*mTypeParameter == 2) {
-            float distortionAmount = *mDistortionParameter;
-            if(distortionAmount > 0.0f) {
-                // Soft clipping distortion
-                delay_sample_left = juce::jlimit(-1.0f, 1.0f, delay_sample_left * (1.0f + distortionAmount * 3.0f));
-                delay_sample_right = juce::jlimit(-1.0f, 1.0f, delay_sample_right * (1.0f + distortionAmount * 3.0f));
-                
-                // Apply tanh saturation for smoother distortion
-                delay_sample_left = std::tanh(delay_sample_left * (1.0f + distortionAmount * 2.0f));
-                delay_sample_right = std::tanh(delay_sample_right * (1.0f + distortionAmount * 2.0f));
-            }
-        }
+    const chaorus::Parameters parameters = getCoreParameters();
 
-        mCircularBufferWriteHead++;
+    mDelayMemory.reserve(mState, chaorus::getDelayMemoryTime(parameters));
 
+    if (timelinePosition) {
+        chaorus::setLFOPhaseAtSample(mState, parameters, *timelinePosition);
+    }
 
-        if (mCircularBufferWriteHead >= mCircularBufferLength) {
-            mCircularBufferWriteHead = 0;
-        }
+    chaorus::process(mState, parameters, channels, channels, numChannels, numSamples);
 
-        float dryAmount = 1 - *mDryWetParameter;
-        float wetAmount = *mDryWetParameter;
+    /* Time the block against its duration and let the governor pick the quality of the next one */
+    int tier = 0;
+    if (adaptiveQuality) {
+        double processSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        tier = mQualityGovernor.update(processSeconds, numSamples / mState.sampleRate);
+    } else {
+        mQualityGovernor.reset();
+    }
 
-        buffer.setSample(0, i, buffer.getSample(0, i) * dryAmount + delay_sample_left * wetAmount);
-        buffer.setSample(1, i, buffer.getSample(1, i) * dryAmount + delay_sample_right * wetAmount);
+    /* A change still fading is left to finish, the next block tries again */
+    if (chaorus::setQuality(mState, chaorus::qualityTiers[tier])) {
+        mQualityTier = tier;
     }
 }
 
@@ -329,6 +274,7 @@ bool ChaorusFlangosAudioProcessor::hasEditor() const
 
 juce::AudioProcessorEditor* ChaorusFlangosAudioProcessor::createEditor()
 {
+    StartupTimer startupTimer("ChaorusFlangosAudioProcessorEditor");
     return new ChaorusFlangosAudioProcessorEditor (*this);
 }
 
@@ -344,6 +290,17 @@ void ChaorusFlangosAudioProcessor::getStateInformation (juce::MemoryBlock& destD
     xml->setAttribute("Feedback", *mFeedbackParameter);
     xml->setAttribute("Distortion", *mDistortionParameter);
     xml->setAttribute("Type", *mTypeParameter);
+    xml->setAttribute("Shape", *mShapeParameter);
+    xml->setAttribute("FlangerDepth", *mFlangerDepthParameter);
+    xml->setAttribute("FlangerRate", *mFlangerRateParameter);
+    xml->setAttribute("FlangerMix", *mFlangerMixParameter);
+    xml->setAttribute("Routing", *mRoutingParameter);
+    xml->setAttribute("BaseDelay", *mBaseDelayParameter);
+    xml->setAttribute("DelayRange", *mDelayRangeParameter);
+    xml->setAttribute("AdaptiveQuality", getAdaptiveQuality());
+    xml->setAttribute("Pipelined", getPipelined());
+    xml->setAttribute("Multirate", getMultirate());
+    xml->setAttribute("TransportLocked", getTransportLocked());
 
     copyXmlToBinary(*xml, destData);
 }
@@ -361,16 +318,184 @@ void ChaorusFlangosAudioProcessor::setStateInformation (const void* data, int si
         *mDistortionParameter = xml->getDoubleAttribute("Distortion");
 
         *mTypeParameter = xml->getIntAttribute("Type");
+        *mShapeParameter = xml->getIntAttribute("Shape", chaorus::Sine);
+
+        *mFlangerDepthParameter = xml->getDoubleAttribute("FlangerDepth", 0.5);
+        *mFlangerRateParameter = xml->getDoubleAttribute("FlangerRate", 0.5);
+        *mFlangerMixParameter = xml->getDoubleAttribute("FlangerMix", 0.5);
+        *mRoutingParameter = xml->getIntAttribute("Routing", chaorus::Parallel);
+        *mBaseDelayParameter = xml->getDoubleAttribute("BaseDelay", 0.0);
+        *mDelayRangeParameter = xml->getDoubleAttribute("DelayRange", defaultDelayRange);
+
+        setAdaptiveQuality(xml->getBoolAttribute("AdaptiveQuality", false));
+        setPipelined(xml->getBoolAttribute("Pipelined", false));
+        setMultirate(xml->getBoolAttribute("Multirate", false));
+        setTransportLocked(xml->getBoolAttribute("TransportLocked", false));
+    }
+}
+
+chaorus::Parameters ChaorusFlangosAudioProcessor::parseCoreParameters(const void* data, int sizeInBytes)
+{
+    /* A state that doesn't parse leaves a processor on its defaults */
+    chaorus::Parameters parameters;
+    parameters.delayRange = defaultDelayRange * 0.001f;
+
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+
+    if (xml.get() == nullptr || !xml->hasTagName("ChaorusFlangos")) {
+        return parameters;
     }
+
+    /* The same attributes and fallbacks as setStateInformation(), held to the parameter ranges */
+    auto getFloat = [&xml](const char* attribute, const juce::NormalisableRange<float>& range, double fallback) {
+        return range.snapToLegalValue((float)xml->getDoubleAttribute(attribute, fallback));
+    };
+
+    auto getInt = [&xml](const char* attribute, int maximum, int fallback) {
+        return juce::jlimit(0, maximum, xml->getIntAttribute(attribute, fallback));
+    };
+
+    parameters.dryWet = getFloat("DryWet", dryWetRange, 0.0);
+    parameters.depth = getFloat("Depth", depthRange, 0.0);
+    parameters.rate = getFloat("Rate", rateRange, 0.0);
+    parameters.phaseOffset = getFloat("PhaseOffset", phaseOffsetRange, 0.0);
+    parameters.feedback = getFloat("Feedback", feedbackRange, 0.0);
+    parameters.distortion = getFloat("Distortion", distortionRange, 0.0);
+    parameters.type = getInt("Type", chaorus::Dual, 0);
+    parameters.shape = getInt("Shape", chaorus::numLFOShapes - 1, chaorus::Sine);
+    parameters.flangerDepth = getFloat("FlangerDepth", flangerDepthRange, 0.5);
+    parameters.flangerRate = getFloat("FlangerRate", flangerRateRange, 0.5);
+    parameters.flangerMix = getFloat("FlangerMix", flangerMixRange, 0.5);
+    parameters.routing = getInt("Routing", chaorus::Serial, chaorus::Parallel);
+    parameters.baseDelay = getFloat("BaseDelay", baseDelayRange, 0.0) * 0.001f;
+    parameters.delayRange = getFloat("DelayRange", delayRangeRange, defaultDelayRange) * 0.001f;
+
+    return parameters;
+}
+
+int ChaorusFlangosAudioProcessor::getNumConstructed()
+{
+    return numConstructed;
 }
 
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
+    /* Timed around the whole construction, base class and bus setup included */
+    StartupTimer startupTimer("ChaorusFlangosAudioProcessor");
     return new ChaorusFlangosAudioProcessor();
 }
 
-float ChaorusFlangosAudioProcessor::lin_interp(float sample_x, float sample_x1, float inPhase) {
-    return (1 - inPhase) * sample_x + inPhase * sample_x1;
+const juce::Array<juce::AudioParameterFloat*>& ChaorusFlangosAudioProcessor::getKnobParameters() const {
+    return mKnobParameters;
+}
+
+juce::AudioParameterInt* ChaorusFlangosAudioProcessor::getTypeParameter() const {
+    return mTypeParameter;
+}
+
+juce::AudioParameterInt* ChaorusFlangosAudioProcessor::getShapeParameter() const {
+    return mShapeParameter;
+}
+
+const juce::Array<juce::AudioParameterFloat*>& ChaorusFlangosAudioProcessor::getDualKnobParameters() const {
+    return mDualKnobParameters;
+}
+
+juce::AudioParameterInt* ChaorusFlangosAudioProcessor::getRoutingParameter() const {
+    return mRoutingParameter;
+}
+
+const juce::Array<juce::AudioParameterFloat*>& ChaorusFlangosAudioProcessor::getDelayKnobParameters() const {
+    return mDelayKnobParameters;
+}
+
+chaorus::Parameters ChaorusFlangosAudioProcessor::getCoreParameters() const {
+    chaorus::Parameters parameters;
+
+    parameters.dryWet = *mDryWetParameter;
+    parameters.depth = *mDepthParameter;
+    parameters.rate = *mRateParameter;
+    parameters.phaseOffset = *mPhaseOffsetParameter;
+    parameters.feedback = *mFeedbackParameter;
+    parameters.distortion = *mDistortionParameter;
+    parameters.type = *mTypeParameter;
+    parameters.shape = *mShapeParameter;
+    parameters.flangerDepth = *mFlangerDepthParameter;
+    parameters.flangerRate = *mFlangerRateParameter;
+    parameters.flangerMix = *mFlangerMixParameter;
+    parameters.routing = *mRoutingParameter;
+    parameters.baseDelay = *mBaseDelayParameter * 0.001f;
+    parameters.delayRange = *mDelayRangeParameter * 0.001f;
+
+    return parameters;
+}
+
+chaorus::KernelLevel ChaorusFlangosAudioProcessor::getKernelLevel() const {
+    return mState.kernels->level;
+}
+
+void ChaorusFlangosAudioProcessor::setKernelLevel(chaorus::KernelLevel level) {
+    mState.kernels = &chaorus::getDSPKernels(juce::jmin(level, chaorus::getSupportedKernelLevel()));
+}
+
+double ChaorusFlangosAudioProcessor::getLFOPhaseAtSample(juce::int64 samplePosition) const {
+    return chaorus::getLFOPhaseAtSample(getCoreParameters(), getSampleRate(), samplePosition);
+}
+
+double ChaorusFlangosAudioProcessor::getFlangerLFOPhaseAtSample(juce::int64 samplePosition) const {
+    return chaorus::getFlangerLFOPhaseAtSample(getCoreParameters(), getSampleRate(), samplePosition);
+}
+
+void ChaorusFlangosAudioProcessor::setLFOPhase(double phase, double flangerPhase) {
+    chaorus::setLFOPhase(mState, phase, flangerPhase);
+}
+
+int ChaorusFlangosAudioProcessor::getPreRollSamples(float floorDb) const {
+    return chaorus::getPreRollSamples(getCoreParameters(), getSampleRate(), floorDb);
+}
+
+void ChaorusFlangosAudioProcessor::seek(juce::int64 samplePosition) {
+    chaorus::seek(mState, getCoreParameters(), samplePosition);
+}
+
+bool ChaorusFlangosAudioProcessor::getAdaptiveQuality() const {
+    return mAdaptiveQuality;
+}
+
+void ChaorusFlangosAudioProcessor::setAdaptiveQuality(bool enabled) {
+    mAdaptiveQuality = enabled;
+}
+
+int ChaorusFlangosAudioProcessor::getQualityTier() const {
+    return mQualityTier;
+}
+
+bool ChaorusFlangosAudioProcessor::getPipelined() const {
+    return mPipelinedRequested;
+}
+
+void ChaorusFlangosAudioProcessor::setPipelined(bool enabled) {
+    mPipelinedRequested = enabled;
+}
+
+int ChaorusFlangosAudioProcessor::getNumMissedDeadlines() const {
+    return mPipeline.getNumMissedDeadlines();
+}
+
+bool ChaorusFlangosAudioProcessor::getMultirate() const {
+    return mMultirateRequested;
+}
+
+void ChaorusFlangosAudioProcessor::setMultirate(bool enabled) {
+    mMultirateRequested = enabled;
+}
+
+bool ChaorusFlangosAudioProcessor::getTransportLocked() const {
+    return mTransportLocked;
+}
+
+void ChaorusFlangosAudioProcessor::setTransportLocked(bool enabled) {
+    mTransportLocked = enabled;
 }
@@ -9,8 +9,11 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-#define MAX_DELAY_TIME 2
+#include "ChaorusCore.h"
+#include "QualityGovernor.h"
+#include "AsyncPipeline.h"
+#include "DelayMemory.h"
+#include "StartupTimer.h"
 
 //==============================================================================
 /**
@@ -31,6 +34,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -55,10 +60,83 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    float lin_interp(float sample_x, float sample_x1, float inPhase);
+    /* Parameters the editor shows as knobs, in display order, and the mode and LFO shape selectors */
+    const juce::Array<juce::AudioParameterFloat*>& getKnobParameters() const;
+    juce::AudioParameterInt* getTypeParameter() const;
+    juce::AudioParameterInt* getShapeParameter() const;
+
+    /* Knobs of Dual mode's flanger engine, in display order, and its routing selector */
+    const juce::Array<juce::AudioParameterFloat*>& getDualKnobParameters() const;
+    juce::AudioParameterInt* getRoutingParameter() const;
+
+    /* Base delay and delay range knobs, in display order. A base delay of 0 keeps the type's own range. */
+    const juce::Array<juce::AudioParameterFloat*>& getDelayKnobParameters() const;
+
+    /* Current parameter values, as the DSP core takes them */
+    chaorus::Parameters getCoreParameters() const;
+
+    /* The parameter values a processor takes from a getStateInformation() blob, as the DSP core
+       takes them, without constructing one. They may differ from getCoreParameters() after
+       setStateInformation() in the last bit, where the parameters normalise them. */
+    static chaorus::Parameters parseCoreParameters(const void* data, int sizeInBytes);
+
+    /* Processors constructed in this process so far, for checking code that shouldn't construct any */
+    static int getNumConstructed();
+
+    /* Instruction set level the processBlock kernels run at */
+    chaorus::KernelLevel getKernelLevel() const;
+    void setKernelLevel(chaorus::KernelLevel level);
+
+    /* Offline rendering support: the LFO phases at any sample of a render that starts
+       at sample 0, and how many samples of input it takes for the feedback tail of
+       earlier input to decay below floorDb */
+    double getLFOPhaseAtSample(juce::int64 samplePosition) const;
+    double getFlangerLFOPhaseAtSample(juce::int64 samplePosition) const;
+    void setLFOPhase(double phase, double flangerPhase = 0.0);
+    int getPreRollSamples(float floorDb) const;
+
+    /* Starts a freshly prepared processor where a render from sample 0 would be at samplePosition,
+       see chaorus::seek() */
+    void seek(juce::int64 samplePosition);
+
+    /* Adaptive quality: when on, the wet path steps down through cheaper quality tiers
+       while processing takes too much of each block's duration, and back up when it doesn't */
+    bool getAdaptiveQuality() const;
+    void setAdaptiveQuality(bool enabled);
+    int getQualityTier() const;
+
+    /* Pipelined mode: the DSP runs on a worker thread one block behind the host, and that
+       block is reported as latency. Takes effect the next time the host prepares the plugin. */
+    bool getPipelined() const;
+    void setPipelined(bool enabled);
+    int getNumMissedDeadlines() const;
+
+    /* Multirate mode: at 88.2 kHz and up the wet path runs decimated to a 44.1/48 kHz class
+       rate and the dry signal is delayed to match, which is reported as latency. Takes effect
+       the next time the host prepares the plugin. */
+    bool getMultirate() const;
+    void setMultirate(bool enabled);
+
+    /* Transport lock: the LFO phases follow the host's play position, as they would be in a
+       render from the start of the timeline, instead of running on from wherever playback
+       started. While the transport is stopped, or without a position from the host, they run on
+       rather than hold still on the stopped position. */
+    bool getTransportLocked() const;
+    void setTransportLocked(bool enabled);
 
 private:
 
+    /* Both processBlock overloads run the core directly on the host's buffers, or hand them
+       to the pipeline */
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+
+    /* Runs the core in place, timing it for the quality governor. With a timeline position,
+       that of the first sample, the LFOs are locked to it first. */
+    template <typename SampleType>
+    void processCore(SampleType* const* channels, int numChannels, int numSamples,
+                     juce::Optional<juce::int64> timelinePosition);
+
     /* Parameters */
     // chorus/flanger
     juce::AudioParameterFloat* mDryWetParameter;
@@ -69,21 +147,45 @@ private:
     juce::AudioParameterFloat* mDistortionParameter;
 
     juce::AudioParameterInt* mTypeParameter;
+    juce::AudioParameterInt* mShapeParameter;
+
+    // dual mode's flanger engine
+    juce::AudioParameterFloat* mFlangerDepthParameter;
+    juce::AudioParameterFloat* mFlangerRateParameter;
+    juce::AudioParameterFloat* mFlangerMixParameter;
+    juce::AudioParameterInt* mRoutingParameter;
+
+    // delay range, in milliseconds
+    juce::AudioParameterFloat* mBaseDelayParameter;
+    juce::AudioParameterFloat* mDelayRangeParameter;
+
+    juce::Array<juce::AudioParameterFloat*> mKnobParameters;
+    juce::Array<juce::AudioParameterFloat*> mDualKnobParameters;
+    juce::Array<juce::AudioParameterFloat*> mDelayKnobParameters;
+
+    /* DSP state, the processor is only an adapter around the core */
+    chaorus::State mState;
 
-    /* LFO Data */
-    float mLFOPhase;
+    /* Delay memory the state points at, grown in the background when the delay range needs more */
+    DelayMemory mDelayMemory;
 
-    // old delay things
+    /* Adaptive quality, the governor only runs on the audio thread */
+    std::atomic<bool> mAdaptiveQuality { false };
+    std::atomic<int> mQualityTier { 0 };
+    chaorus::QualityGovernor mQualityGovernor;
 
-    /* Circular buffers data */
-    float* mCircularBufferLeft;
-    float* mCircularBufferRight;
+    /* Pipelined mode, only ever running between prepareToPlay and releaseResources */
+    std::atomic<bool> mPipelinedRequested { false };
+    std::atomic<bool> mMultirateRequested { false };
 
-    int mCircularBufferWriteHead;
-    int mCircularBufferLength;
+    /* Transport lock. The audio thread reads each block's position off the play head, and it
+       goes to the core with the block, through the pipeline's queue when that is running. */
+    std::atomic<bool> mTransportLocked { false };
 
-    float mFeedbackLeft;
-    float mFeedbackRight;
+    AsyncPipeline mPipeline { [this] (double* const* channels, int numChannels, int numSamples,
+                                      juce::Optional<juce::int64> timelinePosition) {
+        processCore(channels, numChannels, numSamples, timelinePosition);
+    } };
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChaorusFlangosAudioProcessor)
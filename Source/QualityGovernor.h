@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+
+    Picks a quality tier from how long each block takes to process compared
+    with how long it lasts. When the load crosses stepDownLoad the effect steps
+    down to a cheaper tier straight away; it only steps back up after the load
+    has stayed under stepUpLoad for a while, so it doesn't hunt between tiers.
+    Timing is up to the caller, which keeps this free of JUCE and of clocks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ChaorusCore.h"
+
+namespace chaorus
+{
+
+class QualityGovernor
+{
+public:
+    struct Settings
+    {
+        float stepDownLoad = 0.7f;      // fraction of the block duration spent processing
+        float stepUpLoad = 0.35f;
+        int stepUpHoldBlocks = 200;     // blocks the load must stay under stepUpLoad before stepping up
+        int settleBlocks = 16;          // blocks to wait after any step before stepping down again
+        float release = 0.05f;          // how quickly the load estimate follows the load down
+    };
+
+    Settings settings;
+
+    /* Feeds in one block, returns the tier to process the next one at */
+    int update (double processSeconds, double blockSeconds)
+    {
+        if (blockSeconds <= 0) {
+            return mTier;
+        }
+
+        /* Rises with the load at once, falls slowly */
+        const float blockLoad = (float) (processSeconds / blockSeconds);
+        if (blockLoad > mLoad) {
+            mLoad = blockLoad;
+        } else {
+            mLoad += (blockLoad - mLoad) * settings.release;
+        }
+
+        if (mSettleRemaining > 0) {
+            mSettleRemaining--;
+        }
+
+        if (mLoad > settings.stepDownLoad) {
+            mBlocksUnderStepUp = 0;
+
+            if (mTier < numQualityTiers - 1 && mSettleRemaining == 0) {
+                mTier++;
+                mSettleRemaining = settings.settleBlocks;
+
+                /* The cheaper tier's load is not known yet, start measuring it afresh */
+                mLoad = 0;
+            }
+        } else if (mLoad < settings.stepUpLoad) {
+            if (mTier > 0 && ++mBlocksUnderStepUp >= settings.stepUpHoldBlocks) {
+                mTier--;
+                mBlocksUnderStepUp = 0;
+                mSettleRemaining = settings.settleBlocks;
+            }
+        } else {
+            mBlocksUnderStepUp = 0;
+        }
+
+        return mTier;
+    }
+
+    /* Back to full quality with no load history */
+    void reset()
+    {
+        mTier = 0;
+        mLoad = 0;
+        mBlocksUnderStepUp = 0;
+        mSettleRemaining = 0;
+    }
+
+    int getTier() const { return mTier; }
+    float getLoad() const { return mLoad; }
+
+private:
+    int mTier = 0;
+    float mLoad = 0;
+    int mBlocksUnderStepUp = 0;
+    int mSettleRemaining = 0;
+};
+
+} // namespace chaorus
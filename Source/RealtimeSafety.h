@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+
+    Real-time safety checking for test builds. Build with
+    CHAORUSFLANGOS_REALTIME_CHECKS=1 and link Tools/RealtimeSafetyChecker.cpp,
+    and any allocation, mutex lock or blocking system call made on a thread
+    while it is inside a ScopedRealtimeSection fails with a stack trace.
+    The audio callback and the DSP core open one, so the checks only apply
+    while audio is being processed. In normal builds it compiles to nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#ifndef CHAORUSFLANGOS_REALTIME_CHECKS
+ #define CHAORUSFLANGOS_REALTIME_CHECKS 0
+#endif
+
+namespace chaorus
+{
+
+#if CHAORUSFLANGOS_REALTIME_CHECKS
+/* Defined by the checker */
+void enterRealtimeSection() noexcept;
+void exitRealtimeSection() noexcept;
+#endif
+
+/* Marks its scope as code that must be real-time safe, sections may nest */
+class ScopedRealtimeSection
+{
+public:
+    ScopedRealtimeSection() noexcept
+    {
+       #if CHAORUSFLANGOS_REALTIME_CHECKS
+        enterRealtimeSection();
+       #endif
+    }
+
+    ~ScopedRealtimeSection()
+    {
+       #if CHAORUSFLANGOS_REALTIME_CHECKS
+        exitRealtimeSection();
+       #endif
+    }
+
+    ScopedRealtimeSection (const ScopedRealtimeSection&) = delete;
+    ScopedRealtimeSection& operator= (const ScopedRealtimeSection&) = delete;
+};
+
+} // namespace chaorus
@@ -0,0 +1,450 @@
+/*
+  ==============================================================================
+
+    RenderCache.cpp
+
+  ==============================================================================
+*/
+
+#include "RenderCache.h"
+
+namespace
+{
+    /* Bump when the layout of cached renders changes */
+    constexpr juce::uint32 cacheFormatVersion = 1;
+    constexpr juce::uint32 cacheMagic = 0x43524643; // "CFRC"
+
+    /* Frames of input hashed, or read from a reader, at a time */
+    constexpr int hashChunkLength = 65536;
+
+    /* Start of every cached render, followed by numChannels planes of numSamples floats */
+    struct CacheHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 formatVersion;
+        juce::uint64 keyHigh;
+        juce::uint64 keyLow;
+        juce::uint32 numChannels;
+        juce::uint32 reserved;
+        juce::int64 numSamples;
+    };
+
+    //==============================================================================
+    /* Streaming 128-bit hash: xxHash64's four lane stripe loop, finalised twice with different
+       mixing. It runs at several GB/s, well ahead of the disk, but isn't meant to resist
+       deliberately built collisions. */
+    class ContentHasher
+    {
+    public:
+        void update(const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            mTotalSize += size;
+
+            /* Top up a partial stripe first */
+            if (mNumPending > 0) {
+                const size_t fill = juce::jmin(size, stripeSize - mNumPending);
+                std::memcpy(mPending + mNumPending, bytes, fill);
+                mNumPending += fill;
+                bytes += fill;
+                size -= fill;
+
+                if (mNumPending < stripeSize) {
+                    return;
+                }
+
+                consumeStripe(mPending);
+                mNumPending = 0;
+            }
+
+            for (; size >= stripeSize; bytes += stripeSize, size -= stripeSize) {
+                consumeStripe(bytes);
+            }
+
+            std::memcpy(mPending, bytes, size);
+            mNumPending = size;
+        }
+
+        template <typename ValueType>
+        void updateValue(ValueType value)
+        {
+            update(&value, sizeof(value));
+        }
+
+        RenderCache::Key finish() const
+        {
+            RenderCache::Key key;
+            key.high = finalise(1, 7, 12, 18, prime5);
+            key.low = finalise(3, 11, 17, 23, prime3);
+            return key;
+        }
+
+    private:
+        static constexpr size_t stripeSize = 32;
+
+        static constexpr juce::uint64 prime1 = 0x9E3779B185EBCA87ull;
+        static constexpr juce::uint64 prime2 = 0xC2B2AE3D27D4EB4Full;
+        static constexpr juce::uint64 prime3 = 0x165667B19E3779F9ull;
+        static constexpr juce::uint64 prime4 = 0x85EBCA77C2B2AE63ull;
+        static constexpr juce::uint64 prime5 = 0x27D4EB2F165667C5ull;
+
+        static juce::uint64 rotateLeft(juce::uint64 value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        static juce::uint64 round(juce::uint64 accumulator, juce::uint64 lane)
+        {
+            accumulator += lane * prime2;
+            return rotateLeft(accumulator, 31) * prime1;
+        }
+
+        static juce::uint64 avalanche(juce::uint64 hash)
+        {
+            hash ^= hash >> 33;
+            hash *= prime2;
+            hash ^= hash >> 29;
+            hash *= prime3;
+            return hash ^ (hash >> 32);
+        }
+
+        void consumeStripe(const unsigned char* stripe)
+        {
+            for (int lane = 0; lane < 4; lane++) {
+                juce::uint64 value;
+                std::memcpy(&value, stripe + 8 * lane, sizeof(value));
+                mLanes[lane] = round(mLanes[lane], value);
+            }
+        }
+
+        juce::uint64 finalise(int rotate0, int rotate1, int rotate2, int rotate3, juce::uint64 tailPrime) const
+        {
+            juce::uint64 hash = rotateLeft(mLanes[0], rotate0) + rotateLeft(mLanes[1], rotate1)
+                              + rotateLeft(mLanes[2], rotate2) + rotateLeft(mLanes[3], rotate3);
+
+            for (juce::uint64 lane : mLanes) {
+                hash = (hash ^ round(0, lane)) * prime1 + prime4;
+            }
+
+            hash += mTotalSize;
+
+            for (size_t i = 0; i < mNumPending; i++) {
+                hash ^= mPending[i] * tailPrime;
+                hash = rotateLeft(hash, 11) * prime1;
+            }
+
+            return avalanche(hash);
+        }
+
+        juce::uint64 mLanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+        unsigned char mPending[stripeSize];
+        size_t mNumPending = 0;
+        juce::uint64 mTotalSize = 0;
+    };
+
+    void hashParameters(ContentHasher& hasher, const chaorus::Parameters& parameters)
+    {
+        hasher.updateValue(parameters.dryWet);
+        hasher.updateValue(parameters.depth);
+        hasher.updateValue(parameters.rate);
+        hasher.updateValue(parameters.phaseOffset);
+        hasher.updateValue(parameters.feedback);
+        hasher.updateValue(parameters.distortion);
+        hasher.updateValue(parameters.type);
+        hasher.updateValue(parameters.shape);
+        hasher.updateValue(parameters.flangerDepth);
+        hasher.updateValue(parameters.flangerRate);
+        hasher.updateValue(parameters.flangerMix);
+        hasher.updateValue(parameters.routing);
+        hasher.updateValue(parameters.baseDelay);
+        hasher.updateValue(parameters.delayRange);
+    }
+
+    /* Everything but the input audio that decides what a render produces. That is the
+       configuration the render runs with rather than the state blob, which also carries
+       settings an offline render overrides, and it includes the kernels and segment count,
+       which change the last bits and differ between machines. */
+    void hashRequest(ContentHasher& hasher, const juce::MemoryBlock& state, double sampleRate,
+                     const SegmentedRenderer::Options& options, int numChannels, juce::int64 numSamples)
+    {
+        const SegmentedRenderer::Configuration configuration = SegmentedRenderer::getConfiguration(state, sampleRate, numSamples, options);
+
+        hasher.updateValue(cacheFormatVersion);
+        hasher.updateValue(chaorus::engineVersion);
+        hasher.updateValue(sampleRate);
+
+        hashParameters(hasher, configuration.parameters);
+        hasher.updateValue((int)configuration.kernelLevel);
+        hasher.updateValue(configuration.numSegments);
+        hasher.updateValue(configuration.preRollSamples);
+
+        hasher.updateValue(numChannels);
+        hasher.updateValue(numSamples);
+    }
+
+    /* A chunk of input, channel after channel */
+    void hashChunk(ContentHasher& hasher, const juce::AudioBuffer<float>& buffer, int numChannels, int start, int numSamples)
+    {
+        for (int channel = 0; channel < numChannels; channel++) {
+            hasher.update(buffer.getReadPointer(channel, start), (size_t)numSamples * sizeof(float));
+        }
+    }
+}
+
+//==============================================================================
+juce::String RenderCache::Key::toString() const
+{
+    return juce::String::toHexString((juce::int64)high).paddedLeft('0', 16)
+         + juce::String::toHexString((juce::int64)low).paddedLeft('0', 16);
+}
+
+RenderCache::RenderCache(const juce::File& directory, juce::int64 maxSizeBytes)
+    : mDirectory(directory), mMaxSizeBytes(maxSizeBytes)
+{
+}
+
+RenderCache::Key RenderCache::makeKey(const juce::MemoryBlock& state, double sampleRate,
+                                      const juce::AudioBuffer<float>& input, const SegmentedRenderer::Options& options)
+{
+    /* The renderer only ever reads the first two channels */
+    const int numChannels = juce::jmin(2, input.getNumChannels());
+    const int length = input.getNumSamples();
+
+    ContentHasher hasher;
+    hashRequest(hasher, state, sampleRate, options, numChannels, length);
+
+    for (int start = 0; start < length; start += hashChunkLength) {
+        hashChunk(hasher, input, numChannels, start, juce::jmin(hashChunkLength, length - start));
+    }
+
+    return hasher.finish();
+}
+
+RenderCache::Key RenderCache::makeKey(const juce::MemoryBlock& state, juce::AudioFormatReader& reader,
+                                      const SegmentedRenderer::Options& options)
+{
+    const int numChannels = (int)juce::jmin(2u, reader.numChannels);
+    const juce::int64 length = reader.lengthInSamples;
+
+    ContentHasher hasher;
+    hashRequest(hasher, state, reader.sampleRate, options, numChannels, length);
+
+    /* Stream the input through one chunk at a time, it may be far bigger than memory */
+    juce::AudioBuffer<float> chunk(numChannels, hashChunkLength);
+
+    for (juce::int64 start = 0; start < length; start += hashChunkLength) {
+        const int numSamples = (int)juce::jmin((juce::int64)hashChunkLength, length - start);
+
+        reader.read(&chunk, 0, numSamples, start, true, numChannels > 1);
+        hashChunk(hasher, chunk, numChannels, 0, numSamples);
+    }
+
+    return hasher.finish();
+}
+
+//==============================================================================
+bool RenderCache::render(const juce::MemoryBlock& state, double sampleRate,
+                         const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                         const SegmentedRenderer::Options& options)
+{
+   #if JUCE_DEBUG
+    const int numConstructed = ChaorusFlangosAudioProcessor::getNumConstructed();
+   #endif
+
+    const Key key = makeKey(state, sampleRate, input, options);
+
+    if (load(key, output)) {
+        /* A hit comes at disk speed, it must not have constructed a processor */
+        jassert(ChaorusFlangosAudioProcessor::getNumConstructed() == numConstructed);
+
+        mNumHits++;
+        return true;
+    }
+
+    mNumMisses++;
+    SegmentedRenderer::render(state, sampleRate, input, output, options);
+    store(key, output);
+
+    return false;
+}
+
+bool RenderCache::render(const juce::MemoryBlock& state, juce::AudioFormatReader& reader,
+                         juce::AudioBuffer<float>& output, const SegmentedRenderer::Options& options)
+{
+   #if JUCE_DEBUG
+    const int numConstructed = ChaorusFlangosAudioProcessor::getNumConstructed();
+   #endif
+
+    const Key key = makeKey(state, reader, options);
+
+    if (load(key, output)) {
+        jassert(ChaorusFlangosAudioProcessor::getNumConstructed() == numConstructed);
+
+        mNumHits++;
+        return true;
+    }
+
+    mNumMisses++;
+
+    /* Only a miss needs the input in memory */
+    jassert(reader.lengthInSamples <= std::numeric_limits<int>::max());
+    const int numChannels = (int)juce::jmin(2u, reader.numChannels);
+    const int length = (int)reader.lengthInSamples;
+
+    juce::AudioBuffer<float> input(numChannels, length);
+    reader.read(&input, 0, length, 0, true, numChannels > 1);
+
+    SegmentedRenderer::render(state, reader.sampleRate, input, output, options);
+    store(key, output);
+
+    return false;
+}
+
+//==============================================================================
+juce::File RenderCache::getFile(const Key& key) const
+{
+    return mDirectory.getChildFile(key.toString() + ".render");
+}
+
+bool RenderCache::load(const Key& key, juce::AudioBuffer<float>& output)
+{
+    const juce::File file = getFile(key);
+
+    if (!file.existsAsFile()) {
+        return false;
+    }
+
+    bool valid = false;
+
+    {
+        juce::MemoryMappedFile mapped(file, juce::MemoryMappedFile::readOnly);
+        const char* data = static_cast<const char*>(mapped.getData());
+
+        if (data != nullptr && mapped.getSize() >= sizeof(CacheHeader)) {
+            CacheHeader header;
+            std::memcpy(&header, data, sizeof(header));
+
+            const size_t expectedSize = sizeof(CacheHeader) + (size_t)header.numChannels * (size_t)header.numSamples * sizeof(float);
+
+            valid = header.magic == cacheMagic && header.formatVersion == cacheFormatVersion
+                 && header.keyHigh == key.high && header.keyLow == key.low
+                 && header.numSamples >= 0 && header.numSamples <= std::numeric_limits<int>::max()
+                 && mapped.getSize() == expectedSize;
+
+            if (valid) {
+                const int numSamples = (int)header.numSamples;
+                const float* planes = reinterpret_cast<const float*>(data + sizeof(CacheHeader));
+
+                output.setSize((int)header.numChannels, numSamples, false, false, true);
+
+                for (int channel = 0; channel < (int)header.numChannels; channel++) {
+                    output.copyFrom(channel, 0, planes + (size_t)channel * (size_t)numSamples, numSamples);
+                }
+            }
+        }
+    }
+
+    /* Truncated or from another format version, render it again */
+    if (!valid) {
+        file.deleteFile();
+        return false;
+    }
+
+    /* The modification time doubles as the last use, for eviction */
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+    return true;
+}
+
+void RenderCache::store(const Key& key, const juce::AudioBuffer<float>& output)
+{
+    if (!mDirectory.createDirectory().wasOk()) {
+        return;
+    }
+
+    /* Written next to its final name and moved into place whole, so no reader ever maps half a render */
+    juce::TemporaryFile temporary(getFile(key));
+
+    {
+        juce::FileOutputStream stream(temporary.getFile());
+
+        if (!stream.openedOk()) {
+            return;
+        }
+
+        CacheHeader header {};
+        header.magic = cacheMagic;
+        header.formatVersion = cacheFormatVersion;
+        header.keyHigh = key.high;
+        header.keyLow = key.low;
+        header.numChannels = (juce::uint32)output.getNumChannels();
+        header.numSamples = output.getNumSamples();
+
+        bool written = stream.write(&header, sizeof(header));
+
+        for (int channel = 0; channel < output.getNumChannels(); channel++) {
+            written = written && stream.write(output.getReadPointer(channel), (size_t)output.getNumSamples() * sizeof(float));
+        }
+
+        stream.flush();
+
+        if (!written || stream.getStatus().failed()) {
+            return;
+        }
+    }
+
+    if (temporary.overwriteTargetFileWithTemporary()) {
+        trim();
+    }
+}
+
+void RenderCache::trim()
+{
+    struct Entry
+    {
+        juce::File file;
+        juce::int64 size;
+        juce::int64 lastUsed;
+    };
+
+    std::vector<Entry> entries;
+    juce::int64 totalSize = 0;
+
+    for (const juce::File& file : mDirectory.findChildFiles(juce::File::findFiles, false, "*.render")) {
+        entries.push_back({ file, file.getSize(), file.getLastModificationTime().toMilliseconds() });
+        totalSize += entries.back().size;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+    for (const Entry& entry : entries) {
+        if (totalSize <= mMaxSizeBytes) {
+            break;
+        }
+
+        /* Another process may have it mapped where that stops deletion, it goes next time */
+        if (entry.file.deleteFile()) {
+            totalSize -= entry.size;
+        }
+    }
+}
+
+juce::int64 RenderCache::getSizeBytes() const
+{
+    juce::int64 totalSize = 0;
+
+    for (const juce::File& file : mDirectory.findChildFiles(juce::File::findFiles, false, "*.render")) {
+        totalSize += file.getSize();
+    }
+
+    return totalSize;
+}
+
+int RenderCache::getNumHits() const
+{
+    return mNumHits;
+}
+
+int RenderCache::getNumMisses() const
+{
+    return mNumMisses;
+}
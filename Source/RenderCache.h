@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    RenderCache.h
+
+    Content-addressed cache in front of SegmentedRenderer for batch renders.
+    A request is keyed by a hash of the input audio, streamed through in
+    chunks, the sample rate, the engine version and the configuration the
+    render would run with (see SegmentedRenderer::getConfiguration()), so
+    settings an offline render overrides don't cause misses and a directory
+    shared between machines never serves a render made with other kernels
+    or segments. Identical requests are served from an on-disk cache of
+    rendered output through a memory-mapped read, without creating a
+    processor, let alone rendering. The least recently used renders are
+    evicted to keep the cache under a size cap.
+
+    One RenderCache is meant for one thread, but any number of them, in any
+    number of processes, can share a directory: renders are written to a
+    temporary file and moved into place whole.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SegmentedRenderer.h"
+
+class RenderCache
+{
+public:
+    /* 128-bit content hash of a render request */
+    struct Key
+    {
+        juce::uint64 high = 0;
+        juce::uint64 low = 0;
+
+        juce::String toString() const;
+    };
+
+    explicit RenderCache(const juce::File& directory, juce::int64 maxSizeBytes = (juce::int64)4 << 30);
+
+    /* Renders input through state (a getStateInformation() blob) at sampleRate into output,
+       like SegmentedRenderer::render, or copies a cached render of the same request.
+       Returns true if the render came from the cache. */
+    bool render(const juce::MemoryBlock& state, double sampleRate,
+                const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                const SegmentedRenderer::Options& options = {});
+
+    /* render reading the input from reader, which is only read in full on a miss */
+    bool render(const juce::MemoryBlock& state, juce::AudioFormatReader& reader,
+                juce::AudioBuffer<float>& output, const SegmentedRenderer::Options& options = {});
+
+    /* Keys the two render overloads use, the same for the same audio */
+    static Key makeKey(const juce::MemoryBlock& state, double sampleRate,
+                       const juce::AudioBuffer<float>& input, const SegmentedRenderer::Options& options);
+    static Key makeKey(const juce::MemoryBlock& state, juce::AudioFormatReader& reader,
+                       const SegmentedRenderer::Options& options);
+
+    /* Evicts the least recently used renders until the cache fits in maxSizeBytes */
+    void trim();
+
+    juce::int64 getSizeBytes() const;
+    int getNumHits() const;
+    int getNumMisses() const;
+
+private:
+    juce::File getFile(const Key& key) const;
+
+    /* Copies a cached render into output and marks it as used. False if there is none. */
+    bool load(const Key& key, juce::AudioBuffer<float>& output);
+    void store(const Key& key, const juce::AudioBuffer<float>& output);
+
+    juce::File mDirectory;
+    juce::int64 mMaxSizeBytes;
+
+    int mNumHits = 0;
+    int mNumMisses = 0;
+};
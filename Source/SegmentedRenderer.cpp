@@ -0,0 +1,275 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "SegmentedRenderer.h"
+
+//==============================================================================
+class SegmentedRenderer::SegmentJob : public juce::ThreadPoolJob
+{
+public:
+    SegmentJob(const juce::MemoryBlock& state, double sampleRate, int blockSize,
+               const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+               juce::int64 warmUpStart, juce::int64 renderStart, juce::int64 renderEnd, juce::int64 outputOffset)
+        : juce::ThreadPoolJob("ChaorusFlangos segment"),
+          mState(state), mSampleRate(sampleRate), mBlockSize(blockSize),
+          mInput(input), mOutput(output),
+          mWarmUpStart(warmUpStart), mRenderStart(renderStart), mRenderEnd(renderEnd), mOutputOffset(outputOffset)
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        renderRange(mState, mSampleRate, mBlockSize, mInput, mOutput, mWarmUpStart, mRenderStart, mRenderEnd, mOutputOffset);
+        return jobHasFinished;
+    }
+
+private:
+    const juce::MemoryBlock& mState;
+    double mSampleRate;
+    int mBlockSize;
+
+    const juce::AudioBuffer<float>& mInput;
+    juce::AudioBuffer<float>& mOutput;
+
+    juce::int64 mWarmUpStart;
+    juce::int64 mRenderStart;
+    juce::int64 mRenderEnd;
+    juce::int64 mOutputOffset;
+};
+
+//==============================================================================
+void SegmentedRenderer::renderRange(const juce::MemoryBlock& state, double sampleRate, int blockSize,
+                                    const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                    juce::int64 warmUpStart, juce::int64 renderStart, juce::int64 renderEnd,
+                                    juce::int64 outputOffset)
+{
+    ChaorusFlangosAudioProcessor processor;
+    processor.setStateInformation(state.getData(), (int)state.getSize());
+
+    /* Segments are stitched sample-accurately, they can't carry pipeline or multirate latency,
+       and have to come out the same however loaded the machine is */
+    processor.setPipelined(false);
+    processor.setMultirate(false);
+    processor.setAdaptiveQuality(false);
+    processor.setNonRealtime(true);
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    /* Start from the quantum on or before warmUpStart, with the LFOs and the write head where a
+       serial render from sample 0 would have them, so once warmed up the output is the same */
+    warmUpStart -= warmUpStart % chaorus::processingQuantum;
+    processor.seek(warmUpStart);
+
+    juce::AudioBuffer<float> block(2, blockSize);
+    juce::MidiBuffer midi;
+
+    for (juce::int64 position = warmUpStart; position < renderEnd; position += blockSize) {
+        const int numSamples = (int)juce::jmin((juce::int64)blockSize, renderEnd - position);
+
+        block.setSize(2, numSamples, false, false, true);
+        for (int channel = 0; channel < 2; channel++) {
+            block.copyFrom(channel, 0, input, juce::jmin(channel, input.getNumChannels() - 1), (int)position, numSamples);
+        }
+
+        processor.processBlock(block, midi);
+
+        /* Only keep what falls inside the range, the rest was pre-roll */
+        const juce::int64 keepStart = juce::jmax(position, renderStart);
+        if (keepStart < position + numSamples) {
+            const int offset = (int)(keepStart - position);
+            for (int channel = 0; channel < 2; channel++) {
+                output.copyFrom(channel, (int)(keepStart - outputOffset), block, channel, offset, numSamples - offset);
+            }
+        }
+    }
+}
+
+int SegmentedRenderer::getPreRollSamples(const juce::MemoryBlock& state, double sampleRate, const Options& options)
+{
+    const chaorus::Parameters parameters = ChaorusFlangosAudioProcessor::parseCoreParameters(state.getData(), (int)state.getSize());
+
+    return chaorus::getPreRollSamples(parameters, sampleRate, options.preRollFloorDb);
+}
+
+SegmentedRenderer::Configuration SegmentedRenderer::getConfiguration(const juce::MemoryBlock& state, double sampleRate,
+                                                                    juce::int64 numSamples, const Options& options)
+{
+    /* Worked out straight from the state, the render cache keys every request on this and a hit
+       mustn't cost a processor. The segment processors keep the kernels a new state starts on. */
+    Configuration configuration;
+    configuration.parameters = ChaorusFlangosAudioProcessor::parseCoreParameters(state.getData(), (int)state.getSize());
+    configuration.kernelLevel = chaorus::getPreferredKernelLevel();
+    configuration.preRollSamples = chaorus::getPreRollSamples(configuration.parameters, sampleRate, options.preRollFloorDb);
+
+    /* Segments shorter than their pre-roll would spend most of their time warming up */
+    const int numSegments = options.numSegments > 0 ? options.numSegments : juce::SystemStats::getNumCpus();
+    configuration.numSegments = (int)juce::jlimit((juce::int64)1, juce::jmax((juce::int64)1, numSamples / juce::jmax(1, configuration.preRollSamples)),
+                                                  (juce::int64)numSegments);
+
+    return configuration;
+}
+
+SegmentedRenderer::Result SegmentedRenderer::render(ChaorusFlangosAudioProcessor& settings, double sampleRate,
+                                                    const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                                    const Options& options)
+{
+    juce::MemoryBlock state;
+    settings.getStateInformation(state);
+
+    return render(state, sampleRate, input, output, options);
+}
+
+SegmentedRenderer::Result SegmentedRenderer::render(const juce::MemoryBlock& state, double sampleRate,
+                                                    const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                                    const Options& options)
+{
+    Result result;
+
+    const juce::int64 length = input.getNumSamples();
+    output.setSize(2, (int)length, false, false, true);
+
+    const Configuration configuration = getConfiguration(state, sampleRate, length, options);
+    const int numSegments = configuration.numSegments;
+
+    result.preRollSamples = configuration.preRollSamples;
+    result.numSegments = numSegments;
+
+    const juce::int64 segmentLength = (length + numSegments - 1) / numSegments;
+
+    juce::ThreadPool pool(numSegments);
+    juce::OwnedArray<SegmentJob> jobs;
+
+    for (int segment = 0; segment < numSegments; segment++) {
+        const juce::int64 segmentStart = segment * segmentLength;
+        const juce::int64 segmentEnd = juce::jmin(length, segmentStart + segmentLength);
+        const juce::int64 warmUpStart = juce::jmax((juce::int64)0, segmentStart - result.preRollSamples);
+
+        jobs.add(new SegmentJob(state, sampleRate, options.blockSize, input, output, warmUpStart, segmentStart, segmentEnd, 0));
+        pool.addJob(jobs.getLast(), false);
+    }
+
+    for (auto* job : jobs) {
+        pool.waitForJobToFinish(job, -1);
+    }
+
+    if (!options.verifySeams || numSegments == 1) {
+        return result;
+    }
+
+    /* Re-render a window around every seam with twice the pre-roll. That is a serial render only
+       where it reaches back to sample 0; elsewhere it catches output that more pre-roll would
+       still change, and Tools/SegmentedRenderCheck.cpp compares whole segmented renders with
+       serial ones. */
+    juce::OwnedArray<juce::AudioBuffer<float>> references;
+    jobs.clear();
+
+    for (int segment = 1; segment < numSegments; segment++) {
+        const juce::int64 seam = segment * segmentLength;
+        const juce::int64 checkStart = juce::jmax((juce::int64)0, seam - options.seamCheckLength);
+        const juce::int64 checkEnd = juce::jmin(length, seam + options.seamCheckLength);
+        const juce::int64 warmUpStart = juce::jmax((juce::int64)0, checkStart - 2 * (juce::int64)result.preRollSamples);
+
+        auto* reference = references.add(new juce::AudioBuffer<float>(2, (int)(checkEnd - checkStart)));
+        jobs.add(new SegmentJob(state, sampleRate, options.blockSize, input, *reference, warmUpStart, checkStart, checkEnd, checkStart));
+        pool.addJob(jobs.getLast(), false);
+    }
+
+    float maxSeamError = 0;
+
+    for (int segment = 1; segment < numSegments; segment++) {
+        pool.waitForJobToFinish(jobs[segment - 1], -1);
+
+        const juce::int64 seam = segment * segmentLength;
+        const int checkStart = (int)juce::jmax((juce::int64)0, seam - options.seamCheckLength);
+        const int checkEnd = (int)juce::jmin(length, seam + options.seamCheckLength);
+
+        for (int channel = 0; channel < 2; channel++) {
+            const float* rendered = output.getReadPointer(channel);
+            const float* expected = references[segment - 1]->getReadPointer(channel);
+
+            for (int i = checkStart; i < checkEnd; i++) {
+                maxSeamError = juce::jmax(maxSeamError, std::abs(rendered[i] - expected[i - checkStart]));
+            }
+        }
+    }
+
+    result.maxSeamErrorDb = juce::Decibels::gainToDecibels(maxSeamError);
+    result.seamsWithinTolerance = result.maxSeamErrorDb <= options.seamToleranceDb;
+
+    return result;
+}
+
+SegmentedRenderer::Result SegmentedRenderer::rerender(ChaorusFlangosAudioProcessor& settings, double sampleRate,
+                                                      const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                                      juce::int64 editStart, juce::int64 editEnd, const Options& options)
+{
+    juce::MemoryBlock state;
+    settings.getStateInformation(state);
+
+    return rerender(state, sampleRate, input, output, editStart, editEnd, options);
+}
+
+SegmentedRenderer::Result SegmentedRenderer::rerender(const juce::MemoryBlock& state, double sampleRate,
+                                                      const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                                                      juce::int64 editStart, juce::int64 editEnd, const Options& options)
+{
+    jassert(output.getNumChannels() == 2 && output.getNumSamples() == input.getNumSamples());
+
+    Result result;
+    result.numSegments = 1;
+    result.preRollSamples = getPreRollSamples(state, sampleRate, options);
+
+    const juce::int64 length = input.getNumSamples();
+    editStart = juce::jlimit((juce::int64)0, length, editStart);
+    editEnd = juce::jlimit(editStart, length, editEnd);
+
+    /* The edit changes the output from its start until its feedback tail has decayed */
+    result.splicedStart = editStart;
+    result.splicedEnd = editStart < editEnd ? juce::jmin(length, editEnd + result.preRollSamples) : editStart;
+
+    if (result.splicedStart == result.splicedEnd) {
+        return result;
+    }
+
+    const juce::int64 seamCheckLength = options.verifySeams ? options.seamCheckLength : 0;
+    const juce::int64 checkStart = juce::jmax((juce::int64)0, result.splicedStart - seamCheckLength);
+    const juce::int64 checkEnd = juce::jmin(length, result.splicedEnd + seamCheckLength);
+    const juce::int64 warmUpStart = juce::jmax((juce::int64)0, checkStart - result.preRollSamples);
+
+    juce::AudioBuffer<float> rendered(2, (int)(checkEnd - checkStart));
+    renderRange(state, sampleRate, options.blockSize, input, rendered, warmUpStart, checkStart, checkEnd, checkStart);
+
+    /* Either side of the splice the new render must agree with the old one */
+    float maxSeamError = 0;
+
+    auto compare = [&](juce::int64 start, juce::int64 end) {
+        for (int channel = 0; channel < 2; channel++) {
+            const float* existing = output.getReadPointer(channel);
+            const float* expected = rendered.getReadPointer(channel);
+
+            for (juce::int64 i = start; i < end; i++) {
+                maxSeamError = juce::jmax(maxSeamError, std::abs(existing[i] - expected[i - checkStart]));
+            }
+        }
+    };
+
+    compare(checkStart, result.splicedStart);
+    compare(result.splicedEnd, checkEnd);
+
+    if (options.verifySeams) {
+        result.maxSeamErrorDb = juce::Decibels::gainToDecibels(maxSeamError);
+        result.seamsWithinTolerance = result.maxSeamErrorDb <= options.seamToleranceDb;
+    }
+
+    for (int channel = 0; channel < 2; channel++) {
+        output.copyFrom(channel, (int)result.splicedStart, rendered, channel, (int)(result.splicedStart - checkStart),
+                        (int)(result.splicedEnd - result.splicedStart));
+    }
+
+    return result;
+}
@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderer.h
+
+    Offline rendering of one long input on every core. The input is cut into
+    segments and each segment gets its own processor instance, started at the
+    LFO phase the segment would have in a serial render and warmed up with
+    enough pre-roll for the feedback tail of earlier input to decay below a
+    floor. The rendered segments are stitched back into one output.
+
+    After an edit to part of the input, rerender() brings an existing render
+    up to date by rendering only what the edit changes, the edited range and
+    the feedback tail after it, and splicing that in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+class SegmentedRenderer
+{
+public:
+    struct Options
+    {
+        int numSegments = 0;            // 0 renders one segment per CPU core
+        int blockSize = 512;
+        float preRollFloorDb = -96.0f;  // feedback tail level at which pre-roll stops
+
+        bool verifySeams = true;        // re-render the seams with twice the pre-roll and compare
+        int seamCheckLength = 4096;     // samples checked on each side of a seam
+        float seamToleranceDb = -80.0f; // largest allowed seam error, in dBFS
+    };
+
+    struct Result
+    {
+        int numSegments = 0;
+        int preRollSamples = 0;
+
+        bool seamsWithinTolerance = true;
+        float maxSeamErrorDb = -100.0f;
+
+        /* Range of the output rerender() replaced */
+        juce::int64 splicedStart = 0;
+        juce::int64 splicedEnd = 0;
+    };
+
+    /* Everything besides the input that decides the exact output of a render: the parameters
+       the core runs with, the kernels it runs, and how the input is cut into segments */
+    struct Configuration
+    {
+        chaorus::Parameters parameters;
+        chaorus::KernelLevel kernelLevel = chaorus::KernelLevel::Baseline;
+        int numSegments = 1;
+        int preRollSamples = 0;
+    };
+
+    /* The configuration render() uses for numSamples of input through a parameter state, worked
+       out without constructing a processor */
+    static Configuration getConfiguration(const juce::MemoryBlock& state, double sampleRate,
+                                          juce::int64 numSamples, const Options& options);
+
+    /* Renders input through the parameter state of settings (which must be stereo)
+       at sampleRate into output, which is resized to match input */
+    static Result render(ChaorusFlangosAudioProcessor& settings, double sampleRate,
+                         const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                         const Options& options);
+
+    /* render with the parameter state as a getStateInformation() blob */
+    static Result render(const juce::MemoryBlock& state, double sampleRate,
+                         const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                         const Options& options);
+
+    /* Updates output, a render of input before input[editStart, editEnd) was edited, for the
+       edit. Only the edited range and the samples after it that its feedback tail reaches above
+       options.preRollFloorDb are rendered, with pre-roll, and spliced in. With verifySeams the
+       render runs seamCheckLength samples further either side, which must match what output
+       already has there to within seamToleranceDb. */
+    static Result rerender(ChaorusFlangosAudioProcessor& settings, double sampleRate,
+                           const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                           juce::int64 editStart, juce::int64 editEnd, const Options& options);
+
+    /* rerender with the parameter state as a getStateInformation() blob */
+    static Result rerender(const juce::MemoryBlock& state, double sampleRate,
+                           const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                           juce::int64 editStart, juce::int64 editEnd, const Options& options);
+
+    /* Renders input[renderStart, renderEnd) into output starting at renderStart - outputOffset,
+       with a single fresh processor. Input from warmUpStart, rounded down to the core's
+       quantum grid, is processed to warm up the delay lines but not written out. */
+    static void renderRange(const juce::MemoryBlock& state, double sampleRate, int blockSize,
+                            const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output,
+                            juce::int64 warmUpStart, juce::int64 renderStart, juce::int64 renderEnd,
+                            juce::int64 outputOffset);
+
+private:
+    class SegmentJob;
+
+    /* Pre-roll the state needs at sampleRate for options.preRollFloorDb */
+    static int getPreRollSamples(const juce::MemoryBlock& state, double sampleRate, const Options& options);
+};
@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    StartupTimer.h
+
+    Startup-cost measurement mode. Build with CHAORUSFLANGOS_MEASURE_STARTUP=1
+    and every processor and editor the host creates logs how long it took to
+    construct, so host scans and session loads with hundreds of instances can
+    be profiled. The timers sit at the creation call sites rather than in the
+    constructors, which would miss the base classes and members.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef CHAORUSFLANGOS_MEASURE_STARTUP
+ #define CHAORUSFLANGOS_MEASURE_STARTUP 0
+#endif
+
+/* Logs the time between its construction and destruction. Declare it before the object being
+   timed is created. */
+class StartupTimer
+{
+public:
+    explicit StartupTimer(const char* name)
+       #if CHAORUSFLANGOS_MEASURE_STARTUP
+        : mName(name), mStartTicks(juce::Time::getHighResolutionTicks())
+       #endif
+    {
+        juce::ignoreUnused(name);
+    }
+
+    ~StartupTimer()
+    {
+       #if CHAORUSFLANGOS_MEASURE_STARTUP
+        auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - mStartTicks);
+        juce::Logger::writeToLog(juce::String(mName) + " constructed in " + juce::String(elapsed * 1.0e6, 1) + " us");
+       #endif
+    }
+
+private:
+   #if CHAORUSFLANGOS_MEASURE_STARTUP
+    const char* mName;
+    juce::int64 mStartTicks;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE(StartupTimer)
+};
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    WakeSignal.cpp
+
+  ==============================================================================
+*/
+
+#include "WakeSignal.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <cerrno>
+ #include <ctime>
+ #include <semaphore.h>
+#endif
+
+//==============================================================================
+#if JUCE_MAC || JUCE_IOS
+struct WakeSignal::Semaphore
+{
+    Semaphore() : semaphore(dispatch_semaphore_create(0)) {}
+    ~Semaphore() { dispatch_release(semaphore); }
+
+    void post() { dispatch_semaphore_signal(semaphore); }
+
+    bool wait(int timeoutMilliseconds)
+    {
+        return dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, (int64_t) timeoutMilliseconds * NSEC_PER_MSEC)) == 0;
+    }
+
+    dispatch_semaphore_t semaphore;
+};
+#elif JUCE_WINDOWS
+struct WakeSignal::Semaphore
+{
+    Semaphore() : semaphore(CreateSemaphoreW(nullptr, 0, 0x7fffffff, nullptr)) {}
+    ~Semaphore() { CloseHandle(semaphore); }
+
+    void post() { ReleaseSemaphore(semaphore, 1, nullptr); }
+
+    bool wait(int timeoutMilliseconds)
+    {
+        return WaitForSingleObject(semaphore, (DWORD) timeoutMilliseconds) == WAIT_OBJECT_0;
+    }
+
+    HANDLE semaphore;
+};
+#else
+struct WakeSignal::Semaphore
+{
+    Semaphore() { sem_init(&semaphore, 0, 0); }
+    ~Semaphore() { sem_destroy(&semaphore); }
+
+    /* A futex wake when a thread is waiting, and no syscall at all when none is */
+    void post() { sem_post(&semaphore); }
+
+    bool wait(int timeoutMilliseconds)
+    {
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        deadline.tv_sec += timeoutMilliseconds / 1000;
+        deadline.tv_nsec += (long) (timeoutMilliseconds % 1000) * 1000000;
+
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        while (sem_timedwait(&semaphore, &deadline) != 0) {
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    sem_t semaphore;
+};
+#endif
+
+//==============================================================================
+WakeSignal::WakeSignal()
+    : mSemaphore(std::make_unique<Semaphore>())
+{
+}
+
+WakeSignal::~WakeSignal() = default;
+
+void WakeSignal::signal()
+{
+    if (!mSignalled.exchange(true, std::memory_order_acq_rel)) {
+        mSemaphore->post();
+    }
+}
+
+bool WakeSignal::wait(int timeoutMilliseconds)
+{
+    const bool signalled = mSemaphore->wait(timeoutMilliseconds);
+
+    /* Cleared after waking, so a signal from here on posts again. The caller checks for work
+       after this returns, so nothing signalled before now is missed. */
+    mSignalled.store(false, std::memory_order_release);
+
+    return signalled;
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    WakeSignal.h
+
+    Wakes a background thread from the audio thread. juce::Thread::notify()
+    and juce::WaitableEvent take a lock to signal, so this posts an OS
+    semaphore instead, which doesn't, and only when the waiting thread hasn't
+    already been signalled since it last woke.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class WakeSignal
+{
+public:
+    WakeSignal();
+    ~WakeSignal();
+
+    /* Real-time safe. Wakes the thread in wait(), or makes its next wait() return straight
+       away. Signals before it wakes count as one. */
+    void signal();
+
+    /* Waits for signal() or for timeoutMilliseconds, returns true if it was signalled */
+    bool wait(int timeoutMilliseconds);
+
+private:
+    struct Semaphore;
+    std::unique_ptr<Semaphore> mSemaphore;
+
+    std::atomic<bool> mSignalled { false };
+
+    JUCE_DECLARE_NON_COPYABLE(WakeSignal)
+};
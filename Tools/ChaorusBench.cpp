@@ -0,0 +1,323 @@
+/*
+  ==============================================================================
+
+    ChaorusBench.cpp
+
+    Command line benchmark of the DSP core. Needs no JUCE, build it with
+
+        c++ -std=c++17 -O2 -I../Source ChaorusBench.cpp -o ChaorusBench
+
+    and run it from anywhere. Prints the cost per sample of float and double
+    I/O at every kernel level the CPU supports, then the cost per sample at
+    host block sizes from 1 to 4096 samples. The core works on a fixed
+    internal quantum whatever the block size, so the output must be the
+    same samples at every block size, and the cost is flat from a few dozen
+    samples up; below that the fixed cost of each call shows, about twice
+    the cost per sample at 1 sample blocks. Last, the cost per stream of
+    mono streams run one instance each and through the batched engine,
+    which must put out the same samples.
+
+    Exits with 1 if any output differs or the dearest block size costs more
+    than maxBlockSizeCostRatio times the cheapest.
+
+  ==============================================================================
+*/
+
+#include "ChaorusBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int numChannels = 2;
+    constexpr int totalFrames = 48000 * 10;
+
+    /* Highest cost per sample of any host block size over the lowest */
+    constexpr double maxBlockSizeCostRatio = 2.5;
+
+    /* A sine at each channel so the feedback path carries real signal */
+    template <typename SampleType>
+    std::vector<std::vector<SampleType>> makeInput (int blockSize)
+    {
+        std::vector<std::vector<SampleType>> channels (numChannels, std::vector<SampleType> ((size_t) blockSize));
+        for (int channel = 0; channel < numChannels; channel++) {
+            for (int i = 0; i < blockSize; i++) {
+                channels[channel][i] = (SampleType) (0.5 * std::sin (0.01 * (i + 37 * channel)));
+            }
+        }
+        return channels;
+    }
+
+    /* Runs processBlock over totalFrames in blocks of blockSize, returns nanoseconds per frame.
+       Takes the callable as it is rather than through std::function, whose own call would
+       count at small blocks. */
+    template <typename ProcessBlock>
+    double timeRun (int blockSize, const ProcessBlock& processBlock)
+    {
+        /* Warm the caches and the branch predictors first */
+        for (int i = 0; i < 64; i++) {
+            processBlock();
+        }
+
+        const int numBlocks = totalFrames / blockSize;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < numBlocks; i++) {
+            processBlock();
+        }
+
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ((double) numBlocks * blockSize);
+    }
+
+    struct Engine
+    {
+        explicit Engine (chaorus::KernelLevel level)
+            : delayMemory (chaorus::makeDelayMemory (chaorus::getCircularBufferSize (sampleRate)))
+        {
+            chaorus::prepare (state, sampleRate, delayMemory.get());
+            state.kernels = &chaorus::getDSPKernels (level);
+        }
+
+        chaorus::State state;
+        chaorus::Parameters parameters;
+        chaorus::DelayMemoryPtr delayMemory;
+    };
+
+    /* Float I/O, the plain single precision path */
+    double benchFloat (chaorus::KernelLevel level, int blockSize)
+    {
+        Engine engine (level);
+        auto buffers = makeInput<float> (blockSize);
+        float* channels[numChannels] = { buffers[0].data(), buffers[1].data() };
+
+        return timeRun (blockSize, [&] {
+            chaorus::process (engine.state, engine.parameters, channels, channels, numChannels, blockSize);
+        });
+    }
+
+    /* Double I/O straight through the core */
+    double benchDouble (chaorus::KernelLevel level, int blockSize)
+    {
+        Engine engine (level);
+        auto buffers = makeInput<double> (blockSize);
+        double* channels[numChannels] = { buffers[0].data(), buffers[1].data() };
+
+        return timeRun (blockSize, [&] {
+            chaorus::process (engine.state, engine.parameters, channels, channels, numChannels, blockSize);
+        });
+    }
+
+    /* Double I/O the way a float only plugin gets it: the host converts to float and back around every block */
+    double benchDoubleConverted (chaorus::KernelLevel level, int blockSize)
+    {
+        Engine engine (level);
+        auto buffers = makeInput<double> (blockSize);
+        auto scratch = makeInput<float> (blockSize);
+        float* channels[numChannels] = { scratch[0].data(), scratch[1].data() };
+
+        return timeRun (blockSize, [&] {
+            for (int channel = 0; channel < numChannels; channel++) {
+                for (int i = 0; i < blockSize; i++) {
+                    scratch[channel][i] = (float) buffers[channel][i];
+                }
+            }
+
+            chaorus::process (engine.state, engine.parameters, channels, channels, numChannels, blockSize);
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                for (int i = 0; i < blockSize; i++) {
+                    buffers[channel][i] = scratch[channel][i];
+                }
+            }
+        });
+    }
+
+    /* Renders a few seconds of every mode in blocks of blockSize, or in blocks cycling through
+       a few odd sizes when blockSize is 0, and whether every sample is the same as rendering it
+       all in one call */
+    bool isSameAtBlockSize (int blockSize)
+    {
+        const int numFrames = 48000 * 2;
+        const int oddBlockSizes[] = { 1, 3, 7, 37, 100, 511 };
+
+        for (int type = chaorus::Jello; type <= chaorus::Dual; type++) {
+            std::vector<float> rendered[2][numChannels];
+
+            for (int way = 0; way < 2; way++) {
+                Engine engine (chaorus::getPreferredKernelLevel());
+                engine.parameters.type = type;
+                engine.parameters.distortion = 0.5f;
+                engine.parameters.feedback = 0.5f;
+
+                for (int channel = 0; channel < numChannels; channel++) {
+                    rendered[way][channel].resize ((size_t) numFrames);
+
+                    for (int i = 0; i < numFrames; i++) {
+                        rendered[way][channel][i] = (float) (0.5 * std::sin (0.01 * (i + 37 * channel)));
+                    }
+                }
+
+                for (int start = 0, block = 0; start < numFrames; block++) {
+                    int length = numFrames;
+
+                    if (way == 1) {
+                        length = blockSize > 0 ? blockSize : oddBlockSizes[block % (int) std::size (oddBlockSizes)];
+                    }
+
+                    length = std::min (length, numFrames - start);
+
+                    float* channels[numChannels] = { rendered[way][0].data() + start, rendered[way][1].data() + start };
+                    chaorus::process (engine.state, engine.parameters, channels, channels, numChannels, length);
+
+                    start += length;
+                }
+            }
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                if (std::memcmp (rendered[0][channel].data(), rendered[1][channel].data(), (size_t) numFrames * sizeof (float)) != 0) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /* numStreams mono streams of one mode, one instance each and batched. Returns nanoseconds per
+       frame of each stream, and whether both ways put out the same samples. */
+    void benchMonoStreams (int type, int numStreams, double& perInstance, double& batched, bool& identical)
+    {
+        const int blockSize = 512;
+
+        std::vector<chaorus::Parameters> parameters ((size_t) numStreams);
+        std::vector<std::vector<float>> instanceBuffers ((size_t) numStreams, std::vector<float> ((size_t) blockSize));
+        std::vector<std::vector<float>> batchBuffers ((size_t) numStreams, std::vector<float> ((size_t) blockSize));
+        std::vector<std::unique_ptr<Engine>> engines;
+
+        for (int stream = 0; stream < numStreams; stream++) {
+            parameters[stream].type = type;
+            parameters[stream].rate = 0.5f + 0.1f * stream;
+            parameters[stream].distortion = 0.5f;
+
+            engines.emplace_back (new Engine (chaorus::getPreferredKernelLevel()));
+        }
+
+        auto batch = std::make_unique<chaorus::BatchState>();
+        auto batchMemory = chaorus::makeDelayMemory (chaorus::getBatchBufferSize (sampleRate, numStreams));
+        chaorus::prepareBatch (*batch, numStreams, sampleRate, batchMemory.get());
+
+        auto fill = [&] (std::vector<std::vector<float>>& buffers) {
+            for (int stream = 0; stream < numStreams; stream++) {
+                for (int i = 0; i < blockSize; i++) {
+                    buffers[stream][i] = (float) (0.5 * std::sin (0.01 * (i + 37 * stream)));
+                }
+            }
+        };
+
+        /* Both ways from the same input, block by block, comparing as they go */
+        identical = true;
+
+        for (int block = 0; block < 100; block++) {
+            fill (instanceBuffers);
+            fill (batchBuffers);
+
+            for (int stream = 0; stream < numStreams; stream++) {
+                float* channel = instanceBuffers[stream].data();
+                chaorus::process (engines[stream]->state, parameters[stream], &channel, &channel, 1, blockSize);
+                chaorus::submit (*batch, stream, parameters[stream], batchBuffers[stream].data(), batchBuffers[stream].data());
+            }
+
+            chaorus::flush (*batch, blockSize);
+
+            for (int stream = 0; stream < numStreams; stream++) {
+                identical = identical && std::memcmp (instanceBuffers[stream].data(), batchBuffers[stream].data(),
+                                                      (size_t) blockSize * sizeof (float)) == 0;
+            }
+        }
+
+        perInstance = timeRun (blockSize, [&] {
+            for (int stream = 0; stream < numStreams; stream++) {
+                float* channel = instanceBuffers[stream].data();
+                chaorus::process (engines[stream]->state, parameters[stream], &channel, &channel, 1, blockSize);
+            }
+        }) / numStreams;
+
+        batched = timeRun (blockSize, [&] {
+            for (int stream = 0; stream < numStreams; stream++) {
+                chaorus::submit (*batch, stream, parameters[stream], batchBuffers[stream].data(), batchBuffers[stream].data());
+            }
+
+            chaorus::flush (*batch, blockSize);
+        }) / numStreams;
+    }
+}
+
+int main()
+{
+    const chaorus::KernelLevel levels[] = { chaorus::KernelLevel::Baseline,
+                                            chaorus::KernelLevel::AVX2,
+                                            chaorus::KernelLevel::AVX512 };
+    const int blockSize = 512;
+
+    std::printf ("%-10s %14s %14s %22s\n", "kernels", "float ns/smp", "double ns/smp", "double+convert ns/smp");
+
+    for (auto level : levels) {
+        if (level > chaorus::getSupportedKernelLevel()) {
+            continue;
+        }
+
+        std::printf ("%-10s %14.2f %14.2f %22.2f\n", chaorus::getKernelLevelName (level),
+                     benchFloat (level, blockSize),
+                     benchDouble (level, blockSize),
+                     benchDoubleConverted (level, blockSize));
+    }
+
+    bool passed = true;
+    double cheapest = 0.0, dearest = 0.0;
+
+    std::printf ("\n%-10s %14s %10s\n", "block size", "float ns/smp", "identical");
+
+    for (int hostBlockSize = 1; hostBlockSize <= 4096; hostBlockSize *= 2) {
+        const double cost = benchFloat (chaorus::getPreferredKernelLevel(), hostBlockSize);
+        const bool identical = isSameAtBlockSize (hostBlockSize);
+
+        cheapest = hostBlockSize == 1 ? cost : std::min (cheapest, cost);
+        dearest = std::max (dearest, cost);
+        passed = passed && identical;
+
+        std::printf ("%-10d %14.2f %10s\n", hostBlockSize, cost, identical ? "yes" : "NO");
+    }
+
+    const bool identicalAtOddSizes = isSameAtBlockSize (0);
+    const double costRatio = dearest / cheapest;
+    passed = passed && identicalAtOddSizes && costRatio <= maxBlockSizeCostRatio;
+
+    std::printf ("%-10s %14s %10s\n", "odd sizes", "", identicalAtOddSizes ? "yes" : "NO");
+    std::printf ("dearest / cheapest block size: %.2f (at most %.2f)\n", costRatio, maxBlockSizeCostRatio);
+
+    const char* typeNames[] = { "Jello", "Wavy", "Tormentrix", "Dual" };
+    const int numStreams = chaorus::getPreferredBatchLanes();
+
+    std::printf ("\n%d mono streams %20s %20s %10s\n", numStreams, "instances ns/smp", "batched ns/smp", "identical");
+
+    for (int type = chaorus::Jello; type <= chaorus::Dual; type++) {
+        double perInstance, batched;
+        bool identical;
+        benchMonoStreams (type, numStreams, perInstance, batched, identical);
+
+        passed = passed && identical;
+
+        std::printf ("%-15s %20.2f %20.2f %10s\n", typeNames[type], perInstance, batched, identical ? "yes" : "NO");
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,375 @@
+/*
+  ==============================================================================
+
+    EngineDensityBench.cpp
+
+    High instance count benchmark of the DSP engine. Sessions run hundreds
+    of instances round-robin, each one coming back to a cache that the
+    others have flushed, which a single instance benchmark never sees. This
+    prepares 1 to 2000 engines at 48, 96 and 192 kHz the way the processor
+    prepares its own, a chaorus::State on an aligned delay buffer for the delay
+    range, and runs them one block each in turn, like a host working
+    through its tracks. It does so for the default delay range, a slapback
+    and the longest Base Delay and Delay Range settings, whose multi-second
+    buffers stop fitting in the cache long before the short ones do.
+
+    These are engines, not processors. What else a prepared processor
+    holds needs JUCE and isn't counted: its parameters, the DelayMemory
+    that grows its buffer, and the pipeline's block FIFOs when pipelined.
+    Memory per instance is the engine's share of it, a lower bound for the
+    plugin.
+
+    For every instance count it reports the resident memory, bytes per
+    instance, the time per instance block cold (first pass after
+    prepareToPlay) and warm, the share of the real-time budget used, and the
+    last level cache miss rate where perf events are available (Linux with
+    perf_event_paranoid <= 2). The delay buffers are compared against the
+    last level cache size, to show where the whole buffers and where the
+    parts of them each block actually touches stop fitting. The engine state
+    is reported on its own, it is the same size whatever the delay.
+
+    Needs no JUCE, build it with
+
+        c++ -std=c++17 -O2 -I../Source EngineDensityBench.cpp -o EngineDensityBench
+
+    and run it as EngineDensityBench [maxInstances]. Instance counts whose
+    delay buffers wouldn't fit in three quarters of physical memory are
+    skipped.
+
+  ==============================================================================
+*/
+
+#include "ChaorusCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#if defined (__linux__)
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr int blockSize = 512;
+    constexpr int numChannels = 2;
+
+    /* Delay settings benchmarked, from the type's own range out to the longest there is */
+    struct DelaySetting
+    {
+        const char* name;
+        float baseDelay;    // seconds
+        float delayRange;
+    };
+
+    const DelaySetting delaySettings[] = {
+        { "default delay range", 0.0f, 0.0f },
+        { "slapback, 0.5 s base delay", 0.5f, 0.02f },
+        { "longest, maximum base delay and range", chaorus::maxBaseDelay, chaorus::maxDelayRange }
+    };
+
+    chaorus::Parameters getParameters (const DelaySetting& setting)
+    {
+        chaorus::Parameters parameters;
+        parameters.baseDelay = setting.baseDelay;
+        parameters.delayRange = setting.delayRange;
+        return parameters;
+    }
+
+    /* The engine of one plugin instance, as the processor prepares it in prepareToPlay */
+    struct Instance
+    {
+        Instance (double sampleRate, const chaorus::Parameters& parameters)
+        {
+            const double delayTime = chaorus::getDelayMemoryTime (parameters);
+
+            circularBuffer = chaorus::makeDelayMemory (chaorus::getCircularBufferSize (sampleRate, false, delayTime));
+            chaorus::prepare (state, sampleRate, circularBuffer.get(), false, delayTime);
+        }
+
+        chaorus::State state;
+        chaorus::DelayMemoryPtr circularBuffer;
+    };
+
+    //==============================================================================
+    size_t getResidentBytes()
+    {
+       #if defined (__linux__)
+        if (std::FILE* statm = std::fopen ("/proc/self/statm", "r")) {
+            unsigned long size = 0, resident = 0;
+            const int read = std::fscanf (statm, "%lu %lu", &size, &resident);
+            std::fclose (statm);
+
+            if (read == 2) {
+                return (size_t) resident * (size_t) sysconf (_SC_PAGESIZE);
+            }
+        }
+       #endif
+
+        return 0;
+    }
+
+    size_t getPhysicalMemoryBytes()
+    {
+       #if defined (__linux__)
+        return (size_t) sysconf (_SC_PHYS_PAGES) * (size_t) sysconf (_SC_PAGESIZE);
+       #else
+        return (size_t) 8 << 30;
+       #endif
+    }
+
+    size_t getLastLevelCacheBytes()
+    {
+       #if defined (__linux__)
+        for (int index = 4; index >= 0; index--) {
+            char path[128];
+            std::snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+
+            if (std::FILE* file = std::fopen (path, "r")) {
+                unsigned long size = 0;
+                char unit = 0;
+                const int read = std::fscanf (file, "%lu%c", &size, &unit);
+                std::fclose (file);
+
+                if (read >= 1) {
+                    return unit == 'M' ? size << 20 : unit == 'K' ? size << 10 : size;
+                }
+            }
+        }
+       #endif
+
+        return 0;
+    }
+
+    /* Last level cache references and misses of this thread, where perf events are allowed */
+    class CacheMissCounter
+    {
+    public:
+        CacheMissCounter()
+        {
+           #if defined (__linux__)
+            mReferences = open (PERF_COUNT_HW_CACHE_REFERENCES);
+            mMisses = open (PERF_COUNT_HW_CACHE_MISSES);
+           #endif
+        }
+
+        ~CacheMissCounter()
+        {
+           #if defined (__linux__)
+            if (mReferences >= 0) close (mReferences);
+            if (mMisses >= 0) close (mMisses);
+           #endif
+        }
+
+        bool isAvailable() const { return mReferences >= 0 && mMisses >= 0; }
+
+        void start()
+        {
+           #if defined (__linux__)
+            if (isAvailable()) {
+                ioctl (mReferences, PERF_EVENT_IOC_RESET, 0);
+                ioctl (mMisses, PERF_EVENT_IOC_RESET, 0);
+                ioctl (mReferences, PERF_EVENT_IOC_ENABLE, 0);
+                ioctl (mMisses, PERF_EVENT_IOC_ENABLE, 0);
+            }
+           #endif
+        }
+
+        /* Misses per reference since start(), or a negative number without perf events */
+        double stop()
+        {
+           #if defined (__linux__)
+            if (isAvailable()) {
+                ioctl (mReferences, PERF_EVENT_IOC_DISABLE, 0);
+                ioctl (mMisses, PERF_EVENT_IOC_DISABLE, 0);
+
+                long long references = 0, misses = 0;
+                if (read (mReferences, &references, sizeof (references)) == sizeof (references)
+                 && read (mMisses, &misses, sizeof (misses)) == sizeof (misses) && references > 0) {
+                    return (double) misses / (double) references;
+                }
+            }
+           #endif
+
+            return -1.0;
+        }
+
+    private:
+       #if defined (__linux__)
+        static int open (unsigned long long config)
+        {
+            perf_event_attr attributes {};
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof (attributes);
+            attributes.config = config;
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            return (int) syscall (SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+        }
+       #endif
+
+        int mReferences = -1;
+        int mMisses = -1;
+    };
+
+    //==============================================================================
+    constexpr double pi = 3.14159265358979323846;
+    constexpr size_t frameBytes = numChannels * sizeof (float);
+    constexpr size_t cacheLineBytes = 64;
+
+    /* Delay frames one block of one instance touches: the block it writes, and where its reads
+       land, a span of the block plus as far as the LFO sweeps the delay in a block but never
+       more than a cache line per read. At most the span from the longest delay read to the last
+       frame written, and at most the whole buffer. The engine state is counted separately. */
+    size_t getTouchedBytesPerBlock (const chaorus::Parameters& parameters, double sampleRate)
+    {
+        float minDelayTime, maxDelayTime;
+        chaorus::getDelayTimeRange (parameters, parameters.type, minDelayTime, maxDelayTime);
+
+        /* A sine sweeps its whole range in half a period, and sin (pi f T) of it in T */
+        const double sweptFraction = std::sin (std::min (0.5, parameters.rate * blockSize / sampleRate) * pi);
+        const size_t sweptFrames = (size_t) std::ceil ((maxDelayTime - minDelayTime) * sampleRate * sweptFraction);
+
+        const size_t writtenBytes = (size_t) blockSize * frameBytes;
+        const size_t readBytes = std::min (((size_t) blockSize + sweptFrames) * frameBytes, (size_t) blockSize * cacheLineBytes);
+        const size_t spanBytes = ((size_t) blockSize + (size_t) std::ceil (maxDelayTime * sampleRate)) * frameBytes;
+        const size_t bufferBytes = chaorus::getCircularBufferSize (sampleRate, false, chaorus::getDelayMemoryTime (parameters)) * sizeof (float);
+
+        return std::min ({ writtenBytes + readBytes, spanBytes, bufferBytes });
+    }
+
+    struct Run
+    {
+        size_t residentBytes;
+        double coldNsPerBlock;
+        double warmNsPerBlock;
+        double missRate;
+    };
+
+    /* Prepares numInstances engines and runs them round-robin, one block each per host cycle */
+    Run runInstances (int numInstances, double sampleRate, const chaorus::Parameters& parameters, CacheMissCounter& cacheMisses)
+    {
+        const size_t residentBefore = getResidentBytes();
+
+        std::vector<std::unique_ptr<Instance>> instances;
+        instances.reserve ((size_t) numInstances);
+        for (int i = 0; i < numInstances; i++) {
+            instances.emplace_back (new Instance (sampleRate, parameters));
+        }
+
+        Run run {};
+        run.residentBytes = getResidentBytes() - residentBefore;
+
+        std::vector<float> input ((size_t) blockSize * numChannels);
+        std::vector<float> block (input.size());
+
+        for (int i = 0; i < blockSize; i++) {
+            input[(size_t) i] = (float) std::sin (0.01 * i);
+            input[(size_t) (blockSize + i)] = (float) std::sin (0.013 * i);
+        }
+
+        /* One host cycle: every instance processes its next block, in track order */
+        auto cycle = [&] {
+            for (auto& instance : instances) {
+                block = input;
+                float* channels[] = { block.data(), block.data() + blockSize };
+                chaorus::process (instance->state, parameters, channels, channels, numChannels, blockSize);
+            }
+        };
+
+        auto timeCycles = [&] (int numCycles) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < numCycles; i++) {
+                cycle();
+            }
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            return elapsed.count() / ((double) numCycles * numInstances);
+        };
+
+        /* The first pass meets every instance cold, straight after prepareToPlay */
+        run.coldNsPerBlock = timeCycles (1);
+
+        const int numCycles = std::max (4, 4000 / numInstances);
+        cacheMisses.start();
+        run.warmNsPerBlock = timeCycles (numCycles);
+        run.missRate = cacheMisses.stop();
+
+        return run;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const int maxInstances = argc > 1 ? std::atoi (argv[1]) : 2000;
+    const int instanceCounts[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000 };
+    const double sampleRates[] = { 48000.0, 96000.0, 192000.0 };
+
+    const size_t lastLevelCache = getLastLevelCacheBytes();
+    const size_t memoryLimit = getPhysicalMemoryBytes() / 4 * 3;
+
+    CacheMissCounter cacheMisses;
+
+    std::printf ("last level cache %zu KB, LLC miss counters %s, kernels %s, block %d samples\n",
+                 lastLevelCache >> 10, cacheMisses.isAvailable() ? "available" : "unavailable",
+                 chaorus::getKernelLevelName (chaorus::getPreferredKernelLevel()), blockSize);
+
+    for (const DelaySetting& setting : delaySettings) {
+        const chaorus::Parameters parameters = getParameters (setting);
+
+        for (double sampleRate : sampleRates) {
+            const size_t bufferBytes = chaorus::getCircularBufferSize (sampleRate, false, chaorus::getDelayMemoryTime (parameters))
+                                     * sizeof (float);
+            const size_t touchedBytes = getTouchedBytesPerBlock (parameters, sampleRate);
+            const double budgetNs = blockSize / sampleRate * 1.0e9;
+
+            std::printf ("\n%s at %.0f Hz: %zu KB delay buffer and %zu KB engine state per instance, %zu KB of the buffer touched per block\n",
+                         setting.name, sampleRate, bufferBytes >> 10, sizeof (chaorus::State) >> 10, touchedBytes >> 10);
+            std::printf ("%9s %11s %12s %12s %12s %10s %9s  %s\n", "instances", "RSS MB", "bytes/inst",
+                         "cold ns/blk", "warm ns/blk", "% budget", "LLC miss", "fits in LLC");
+
+            for (int numInstances : instanceCounts) {
+                if (numInstances > maxInstances) {
+                    break;
+                }
+
+                if ((size_t) numInstances * bufferBytes > memoryLimit) {
+                    std::printf ("%9d  skipped, needs %zu MB\n", numInstances, ((size_t) numInstances * bufferBytes) >> 20);
+                    continue;
+                }
+
+                const Run run = runInstances (numInstances, sampleRate, parameters, cacheMisses);
+
+                /* Whole buffers, just the part each block touches, or neither */
+                const char* fits = "neither";
+                if ((size_t) numInstances * bufferBytes <= lastLevelCache) {
+                    fits = "buffers";
+                } else if ((size_t) numInstances * touchedBytes <= lastLevelCache) {
+                    fits = "touched";
+                }
+
+                char missRate[16];
+                if (run.missRate >= 0) {
+                    std::snprintf (missRate, sizeof (missRate), "%.1f%%", run.missRate * 100.0);
+                } else {
+                    std::snprintf (missRate, sizeof (missRate), "n/a");
+                }
+
+                std::printf ("%9d %11.1f %12zu %12.0f %12.0f %9.1f%% %9s  %s\n",
+                             numInstances, run.residentBytes / 1048576.0, run.residentBytes / (size_t) numInstances,
+                             run.coldNsPerBlock, run.warmNsPerBlock,
+                             100.0 * run.warmNsPerBlock * numInstances / budgetNs, missRate, fits);
+            }
+        }
+    }
+
+    return 0;
+}
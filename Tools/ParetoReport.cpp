@@ -0,0 +1,538 @@
+/*
+  ==============================================================================
+
+    ParetoReport.cpp
+
+    Quality against cost for every processing configuration of the DSP core:
+    each mode at each interpolation method, LFO control rate and, for
+    Tormentrix, saturation approximation. Needs no JUCE, build it with
+
+        c++ -std=c++17 -O2 -I../Source ParetoReport.cpp -o ParetoReport
+
+    and run it as ParetoReport [output.csv]. It prints one table row per
+    configuration and writes the same numbers as CSV for plotting (pareto.csv
+    by default). Configurations no other one beats on cost and every quality
+    measure at once are marked as Pareto optimal, where beating takes more
+    than 0.1 dB on a quality measure or 5% on cost, so that measurement
+    jitter doesn't keep configurations on the front.
+
+    Every measurement runs the effect wet only with no feedback, so it sees
+    the wet path alone. The interpolation only comes into play while the
+    delay moves, a fixed delay is an integer number of samples or an
+    interpolation filter that adds no distortion, so the distortion measures
+    run under the default modulation and take the error against the exact
+    modulated delay (and saturation) of the same input:
+
+    - THD+N: a 997 Hz sine, the error relative to the exact output
+    - aliasing: an exponential sine sweep from 1 kHz to 20 kHz, the error
+      below the swept tone, where only what folded over Nyquist lands,
+      relative to the exact output
+    - modulation noise: a multitone, the error relative to the exact output
+    - HF loss: white noise under the default modulation, 12-20 kHz gain
+      relative to 0.5-4 kHz gain, which is mostly the lin_interp rolloff
+    - cost: nanoseconds per stereo frame processing the noise in 512 sample blocks
+
+  ==============================================================================
+*/
+
+#include "ChaorusCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr double pi = 3.14159265358979323846;
+    constexpr int blockSize = 512;
+    constexpr double distortion = 0.5;      // Tormentrix drive for every measurement
+
+    struct Configuration
+    {
+        int type;
+        chaorus::Quality quality;
+    };
+
+    struct Measurements
+    {
+        double thdNoiseDb;
+        double aliasingDb;
+        double modulationNoiseDb;
+        double highFrequencyLossDb;
+        double nsPerSample;
+        bool paretoOptimal = false;
+    };
+
+    const char* getTypeName (int type)
+    {
+        switch (type) {
+            case chaorus::Jello:        return "Jello";
+            case chaorus::Wavy:         return "Wavy";
+            case chaorus::Tormentrix:   return "Tormentrix";
+            default:                    break;
+        }
+
+        return "?";
+    }
+
+    const char* getInterpolationName (chaorus::Interpolation interpolation)
+    {
+        return interpolation == chaorus::Interpolation::Nearest ? "nearest" : "linear";
+    }
+
+    const char* getSaturationName (chaorus::Saturation saturation)
+    {
+        return saturation == chaorus::Saturation::Rational ? "rational" : "tanh";
+    }
+
+    double toDb (double powerRatio)
+    {
+        return 10.0 * std::log10 (std::max (powerRatio, 1.0e-30));
+    }
+
+    //==============================================================================
+    /* In place radix-2 FFT, size a power of two */
+    void fft (std::vector<std::complex<double>>& data)
+    {
+        const size_t size = data.size();
+
+        for (size_t i = 1, j = 0; i < size; i++) {
+            size_t bit = size >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j ^= bit;
+
+            if (i < j) {
+                std::swap (data[i], data[j]);
+            }
+        }
+
+        for (size_t length = 2; length <= size; length <<= 1) {
+            const std::complex<double> step = std::polar (1.0, -2.0 * pi / (double) length);
+
+            for (size_t start = 0; start < size; start += length) {
+                std::complex<double> twiddle = 1.0;
+
+                for (size_t k = 0; k < length / 2; k++) {
+                    std::complex<double> even = data[start + k];
+                    std::complex<double> odd = data[start + k + length / 2] * twiddle;
+                    data[start + k] = even + odd;
+                    data[start + k + length / 2] = even - odd;
+                    twiddle *= step;
+                }
+            }
+        }
+    }
+
+    /* Power spectrum of signal[start, start + size) under a Blackman-Harris window, bins 0 to size / 2 */
+    std::vector<double> powerSpectrum (const std::vector<float>& signal, size_t start, size_t size)
+    {
+        std::vector<std::complex<double>> data (size);
+        for (size_t i = 0; i < size; i++) {
+            const double x = 2.0 * pi * (double) i / (double) size;
+            const double window = 0.35875 - 0.48829 * std::cos (x) + 0.14128 * std::cos (2 * x) - 0.01168 * std::cos (3 * x);
+            data[i] = signal[start + i] * window;
+        }
+
+        fft (data);
+
+        std::vector<double> power (size / 2 + 1);
+        for (size_t i = 0; i < power.size(); i++) {
+            power[i] = std::norm (data[i]);
+        }
+        return power;
+    }
+
+    double binFrequency (size_t bin, size_t fftSize)
+    {
+        return (double) bin * sampleRate / (double) fftSize;
+    }
+
+    //==============================================================================
+    /* Runs the left channel of input through a fresh instance of the effect, wet only and without feedback */
+    std::vector<float> render (const Configuration& configuration, float depth, const std::vector<float>& input)
+    {
+        auto delayMemory = chaorus::makeDelayMemory (chaorus::getCircularBufferSize (sampleRate));
+
+        chaorus::State state;
+        state.quality = configuration.quality;
+        chaorus::prepare (state, sampleRate, delayMemory.get());
+
+        chaorus::Parameters parameters;
+        parameters.type = configuration.type;
+        parameters.dryWet = 1.0f;
+        parameters.feedback = 0.0f;
+        parameters.depth = depth;
+        parameters.distortion = (float) distortion;
+
+        std::vector<float> left (input), right (input);
+
+        for (size_t start = 0; start < input.size(); start += blockSize) {
+            const int frames = (int) std::min<size_t> (blockSize, input.size() - start);
+            float* channels[] = { left.data() + start, right.data() + start };
+            chaorus::process (state, parameters, channels, channels, 2, frames);
+        }
+
+        return left;
+    }
+
+    /* Delay the core's LFO gives at a sample, in samples, worked out in double precision */
+    double getExactDelay (int type, float depth, int64_t sample)
+    {
+        chaorus::Parameters parameters;
+        parameters.type = type;
+
+        float minDelayTime, maxDelayTime;
+        chaorus::getDelayTimeRange (type, minDelayTime, maxDelayTime);
+
+        const double minDelaySamples = sampleRate * minDelayTime;
+        const double halfRange = 0.5 * sampleRate * (maxDelayTime - minDelayTime);
+        const double phase = chaorus::getLFOPhaseAtSample (parameters, sampleRate, sample);
+
+        return minDelaySamples + (depth * std::sin (2.0 * pi * phase) + 1.0) * halfRange;
+    }
+
+    /* Fastest the delay changes under the LFO, in samples per sample */
+    double getMaxDelaySlope (int type, float depth)
+    {
+        chaorus::Parameters parameters;
+
+        float minDelayTime, maxDelayTime;
+        chaorus::getDelayTimeRange (type, minDelayTime, maxDelayTime);
+
+        return depth * 0.5 * (maxDelayTime - minDelayTime) * 2.0 * pi * parameters.rate;
+    }
+
+    /* Longest delay of a mode, in samples, after which the output is all signal */
+    size_t getSettleSamples (int type)
+    {
+        float minDelayTime, maxDelayTime;
+        chaorus::getDelayTimeRange (type, minDelayTime, maxDelayTime);
+        return (size_t) std::ceil (maxDelayTime * sampleRate) + 1;
+    }
+
+    /* What Tormentrix's saturation does to a sample, exactly */
+    double saturate (int type, double sample)
+    {
+        if (type != chaorus::Tormentrix) {
+            return sample;
+        }
+
+        const double clipped = std::min (1.0, std::max (-1.0, sample * (1.0 + distortion * 3.0)));
+        return std::tanh (clipped * (1.0 + distortion * 2.0));
+    }
+
+    /* The wet output a mode should give for length samples of an input that can be evaluated
+       anywhere between samples: the input at i - delay (i), saturated */
+    template <typename Input>
+    std::vector<double> renderExact (int type, float depth, size_t length, Input input)
+    {
+        std::vector<double> output (length);
+        for (size_t i = 0; i < length; i++) {
+            output[i] = saturate (type, input ((double) i - getExactDelay (type, depth, (int64_t) i)));
+        }
+        return output;
+    }
+
+    /* Error of the rendered output from the exact one after settle, relative to the exact one */
+    double getErrorDb (const std::vector<float>& output, const std::vector<double>& exact, size_t settle)
+    {
+        double signal = 0, error = 0;
+        for (size_t i = settle; i < exact.size(); i++) {
+            signal += exact[i] * exact[i];
+            error += (output[i] - exact[i]) * (output[i] - exact[i]);
+        }
+        return toDb (error / signal);
+    }
+
+    //==============================================================================
+    /* Depth of the default modulation every measure but the cost runs under */
+    constexpr float modulationDepth = 0.5f;
+
+    double measureThdNoise (const Configuration& configuration)
+    {
+        const size_t length = 1 << 16;
+        const size_t settle = getSettleSamples (configuration.type);
+        const double frequency = 997.0;
+
+        auto sine = [&] (double time) {
+            return 0.5 * std::sin (2.0 * pi * frequency * time / sampleRate);
+        };
+
+        std::vector<float> input (settle + length);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = (float) sine ((double) i);
+        }
+
+        /* Under modulation the sine is bent in pitch, the exact output is what is left as the fundamental */
+        auto output = render (configuration, modulationDepth, input);
+        auto exact = renderExact (configuration.type, modulationDepth, input.size(), sine);
+
+        return getErrorDb (output, exact, settle);
+    }
+
+    double measureAliasing (const Configuration& configuration)
+    {
+        const size_t frameSize = 4096;
+        const size_t sweepLength = 1 << 18;
+        const size_t settle = getSettleSamples (configuration.type);
+        const double startFrequency = 1000.0, endFrequency = 20000.0;
+
+        /* Exponential sweep, the instantaneous frequency at sample i is startFrequency * exp (i * rate) */
+        const double rate = std::log (endFrequency / startFrequency) / (double) sweepLength;
+        auto frequencyAt = [&] (double i) { return startFrequency * std::exp (i * rate); };
+
+        /* Silent until the sweep starts at settle */
+        auto sweep = [&] (double time) {
+            const double i = time - (double) settle;
+            return i < 0 ? 0.0 : 0.5 * std::sin (2.0 * pi * startFrequency * (std::exp (i * rate) - 1.0) / (rate * sampleRate));
+        };
+
+        std::vector<float> input (settle + sweepLength);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = (float) sweep ((double) i);
+        }
+
+        auto output = render (configuration, modulationDepth, input);
+        auto exact = renderExact (configuration.type, modulationDepth, input.size(), sweep);
+
+        std::vector<float> exactOutput (exact.begin(), exact.end()), error (input.size());
+        for (size_t i = 0; i < input.size(); i++) {
+            error[i] = (float) (output[i] - exact[i]);
+        }
+
+        /* The modulation bends the tone's pitch by up to the delay's slope either way */
+        const double slope = getMaxDelaySlope (configuration.type, modulationDepth);
+        double tone = 0, aliases = 0;
+
+        /* Harmonics and interpolation images only land above the tone, so error well below it has
+           folded over Nyquist. The output lags the sweep by up to settle samples. */
+        for (size_t start = settle; start + frameSize <= sweepLength; start += frameSize / 2) {
+            auto tonePower = powerSpectrum (exactOutput, settle + start, frameSize);
+            auto errorPower = powerSpectrum (error, settle + start, frameSize);
+
+            const double lowest = 0.9 * (1.0 - slope) * frequencyAt ((double) start - (double) settle);
+
+            for (size_t bin = 4; bin < errorPower.size(); bin++) {
+                tone += tonePower[bin];
+
+                if (binFrequency (bin, frameSize) < lowest) {
+                    aliases += errorPower[bin];
+                }
+            }
+        }
+
+        return toDb (aliases / tone);
+    }
+
+    double measureModulationNoise (const Configuration& configuration)
+    {
+        const float depth = modulationDepth;
+        const size_t length = 1 << 17;
+        const size_t settle = getSettleSamples (configuration.type);
+        const double frequencies[] = { 110.0, 247.0, 523.0, 1103.0, 2311.0, 4789.0, 8017.0, 12007.0 };
+
+        auto multitone = [&] (double time) {
+            double sum = 0;
+            for (double frequency : frequencies) {
+                sum += 0.1 * std::sin (2.0 * pi * frequency * time / sampleRate);
+            }
+            return sum;
+        };
+
+        std::vector<float> input (settle + length);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = (float) multitone ((double) i);
+        }
+
+        auto output = render (configuration, depth, input);
+        auto exact = renderExact (configuration.type, depth, input.size(), multitone);
+
+        return getErrorDb (output, exact, settle);
+    }
+
+    std::vector<float> makeNoise (size_t length)
+    {
+        std::vector<float> noise (length);
+        uint32_t seed = 0x1234567u;
+
+        for (auto& sample : noise) {
+            seed = seed * 1664525u + 1013904223u;
+            sample = (float) ((seed >> 8) / double (1 << 24) - 0.5);
+        }
+        return noise;
+    }
+
+    double measureHighFrequencyLoss (const Configuration& configuration)
+    {
+        const size_t frameSize = 4096;
+        const size_t settle = getSettleSamples (configuration.type);
+
+        auto input = makeNoise (settle + (1 << 18));
+        auto output = render (configuration, 0.5f, input);
+
+        double inputLow = 0, inputHigh = 0, outputLow = 0, outputHigh = 0;
+
+        for (size_t start = settle; start + frameSize <= input.size(); start += frameSize / 2) {
+            auto inputPower = powerSpectrum (input, start, frameSize);
+            auto outputPower = powerSpectrum (output, start, frameSize);
+
+            for (size_t bin = 0; bin < inputPower.size(); bin++) {
+                const double frequency = binFrequency (bin, frameSize);
+
+                if (frequency >= 500.0 && frequency <= 4000.0) {
+                    inputLow += inputPower[bin];
+                    outputLow += outputPower[bin];
+                } else if (frequency >= 12000.0 && frequency <= 20000.0) {
+                    inputHigh += inputPower[bin];
+                    outputHigh += outputPower[bin];
+                }
+            }
+        }
+
+        return toDb (outputHigh / inputHigh) - toDb (outputLow / inputLow);
+    }
+
+    double measureCost (const Configuration& configuration)
+    {
+        const auto input = makeNoise (48000 * 5);
+        double fastest = 0;
+
+        /* Best of a few runs, the others are mostly the machine being busy elsewhere */
+        for (int run = 0; run < 3; run++) {
+            auto start = std::chrono::steady_clock::now();
+            auto output = render (configuration, 0.5f, input);
+            std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+            const double nsPerSample = elapsed.count() / (double) input.size();
+            fastest = run == 0 ? nsPerSample : std::min (fastest, nsPerSample);
+        }
+
+        return fastest;
+    }
+
+    //==============================================================================
+    /* Differences smaller than these are measurement jitter, not one configuration being better:
+       a tenth of a dB on the quality measures, and a twentieth of the cost */
+    constexpr double qualityToleranceDb = 0.1;
+    constexpr double relativeCostTolerance = 0.05;
+
+    /* Lower is better for every measure but the HF loss, which is closer to 0 dB the better. a
+       dominates b if it is no worse on any measure and better on one, beyond the tolerances. */
+    bool dominates (const Measurements& a, const Measurements& b)
+    {
+        const double costTolerance = relativeCostTolerance * std::max (a.nsPerSample, b.nsPerSample);
+
+        const double aValues[] = { a.thdNoiseDb, a.aliasingDb, a.modulationNoiseDb, -a.highFrequencyLossDb, a.nsPerSample };
+        const double bValues[] = { b.thdNoiseDb, b.aliasingDb, b.modulationNoiseDb, -b.highFrequencyLossDb, b.nsPerSample };
+        const double tolerances[] = { qualityToleranceDb, qualityToleranceDb, qualityToleranceDb, qualityToleranceDb, costTolerance };
+
+        bool better = false;
+        for (int i = 0; i < 5; i++) {
+            if (aValues[i] > bValues[i] + tolerances[i]) {
+                return false;
+            }
+            better = better || aValues[i] < bValues[i] - tolerances[i];
+        }
+        return better;
+    }
+
+    std::vector<Configuration> makeConfigurations()
+    {
+        const int controlIntervals[] = { 1, 4, 8, 16, 32 };
+        const chaorus::Interpolation interpolations[] = { chaorus::Interpolation::Linear, chaorus::Interpolation::Nearest };
+        const chaorus::Saturation saturations[] = { chaorus::Saturation::Tanh, chaorus::Saturation::Rational };
+
+        std::vector<Configuration> configurations;
+
+        for (int type : { chaorus::Jello, chaorus::Wavy, chaorus::Tormentrix }) {
+            for (auto interpolation : interpolations) {
+                for (int controlInterval : controlIntervals) {
+                    for (auto saturation : saturations) {
+                        /* Only Tormentrix saturates */
+                        if (type != chaorus::Tormentrix && saturation != chaorus::Saturation::Tanh) {
+                            continue;
+                        }
+
+                        configurations.push_back ({ type, { controlInterval, interpolation, saturation } });
+                    }
+                }
+            }
+        }
+
+        return configurations;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const std::string csvPath = argc > 1 ? argv[1] : "pareto.csv";
+
+    const auto configurations = makeConfigurations();
+    std::vector<Measurements> measurements;
+
+    for (const auto& configuration : configurations) {
+        measurements.push_back ({ measureThdNoise (configuration),
+                                  measureAliasing (configuration),
+                                  measureModulationNoise (configuration),
+                                  measureHighFrequencyLoss (configuration),
+                                  measureCost (configuration) });
+    }
+
+    /* Pareto front within each mode, configurations of different modes don't do the same job */
+    for (size_t i = 0; i < configurations.size(); i++) {
+        measurements[i].paretoOptimal = true;
+
+        for (size_t j = 0; j < configurations.size(); j++) {
+            if (configurations[j].type == configurations[i].type && dominates (measurements[j], measurements[i])) {
+                measurements[i].paretoOptimal = false;
+                break;
+            }
+        }
+    }
+
+    std::FILE* csv = std::fopen (csvPath.c_str(), "w");
+    if (csv != nullptr) {
+        std::fprintf (csv, "mode,interpolation,control_interval,saturation,thd_n_db,aliasing_db,"
+                           "modulation_noise_db,hf_loss_db,ns_per_sample,pareto_optimal\n");
+    }
+
+    std::printf ("%-10s %-8s %5s %-8s %9s %9s %9s %8s %8s %s\n",
+                 "mode", "interp", "ctrl", "sat", "THD+N dB", "alias dB", "mod dB", "HF dB", "ns/smp", "pareto");
+
+    for (size_t i = 0; i < configurations.size(); i++) {
+        const auto& configuration = configurations[i];
+        const auto& measured = measurements[i];
+
+        const char* saturation = configuration.type == chaorus::Tormentrix
+                                   ? getSaturationName (configuration.quality.saturation) : "-";
+
+        std::printf ("%-10s %-8s %5d %-8s %9.1f %9.1f %9.1f %8.2f %8.2f %s\n",
+                     getTypeName (configuration.type), getInterpolationName (configuration.quality.interpolation),
+                     configuration.quality.controlInterval, saturation,
+                     measured.thdNoiseDb, measured.aliasingDb, measured.modulationNoiseDb,
+                     measured.highFrequencyLossDb, measured.nsPerSample, measured.paretoOptimal ? "*" : "");
+
+        if (csv != nullptr) {
+            std::fprintf (csv, "%s,%s,%d,%s,%.2f,%.2f,%.2f,%.3f,%.3f,%d\n",
+                          getTypeName (configuration.type), getInterpolationName (configuration.quality.interpolation),
+                          configuration.quality.controlInterval, saturation,
+                          measured.thdNoiseDb, measured.aliasingDb, measured.modulationNoiseDb,
+                          measured.highFrequencyLossDb, measured.nsPerSample, measured.paretoOptimal ? 1 : 0);
+        }
+    }
+
+    if (csv == nullptr) {
+        std::fprintf (stderr, "Couldn't write %s\n", csvPath.c_str());
+        return 1;
+    }
+
+    std::fclose (csv);
+    return 0;
+}
@@ -0,0 +1,375 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyChecker.cpp
+
+    Interposes on operator new and delete, the malloc family, mutex locks,
+    condition variable waits and blocking file and sleep system calls, and
+    fails on any of them made by a thread inside a chaorus::ScopedRealtimeSection.
+    A violation prints what was called and a stack trace, then aborts; with
+    CHAORUSFLANGOS_REALTIME_CHECKS_MODE=log in the environment it only prints
+    and carries on, and a count is printed at exit.
+
+    Linux with glibc only. To run a tool or test under it, build it with the
+    checks on and this file linked in, for example
+
+        c++ -std=c++17 -O1 -g -rdynamic -DCHAORUSFLANGOS_REALTIME_CHECKS=1 -I../Source \
+            ChaorusBench.cpp RealtimeSafetyChecker.cpp -ldl -o ChaorusBench
+
+    A plugin build does the same by adding CHAORUSFLANGOS_REALTIME_CHECKS=1 to
+    its preprocessor definitions and this file to its sources.
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#if ! CHAORUSFLANGOS_REALTIME_CHECKS
+ #error "Build with CHAORUSFLANGOS_REALTIME_CHECKS=1 when linking the real-time safety checker"
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if ! defined (__linux__) || ! defined (__GLIBC__)
+ #error "The real-time safety checker needs Linux and glibc"
+#endif
+
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+
+namespace
+{
+    /* Initial-exec TLS, so looking these up never allocates */
+    __attribute__((tls_model ("initial-exec"))) thread_local int realtimeDepth = 0;
+    __attribute__((tls_model ("initial-exec"))) thread_local bool reporting = false;
+
+    std::atomic<int> numViolations { 0 };
+    bool abortOnViolation = true;
+
+    /* Writes straight to stderr through the system call, which isn't interposed */
+    void writeError (const char* text)
+    {
+        syscall (SYS_write, 2, text, strlen (text));
+    }
+
+    void violation (const char* what)
+    {
+        if (realtimeDepth == 0 || reporting) {
+            return;
+        }
+
+        /* Anything the report itself calls mustn't report again */
+        reporting = true;
+        numViolations++;
+
+        char message[256];
+        snprintf (message, sizeof (message), "\nReal-time safety violation: %s called inside a real-time section\n", what);
+        writeError (message);
+
+        void* frames[64];
+        const int numFrames = backtrace (frames, 64);
+        backtrace_symbols_fd (frames, numFrames, 2);
+
+        if (abortOnViolation) {
+            abort();
+        }
+
+        reporting = false;
+    }
+
+    template <typename Function>
+    Function findNext (const char* name)
+    {
+        return reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+    }
+
+    using MutexLock = int (*) (pthread_mutex_t*);
+    using ConditionWait = int (*) (pthread_cond_t*, pthread_mutex_t*);
+    using ConditionTimedWait = int (*) (pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+    using Read = ssize_t (*) (int, void*, size_t);
+    using Write = ssize_t (*) (int, const void*, size_t);
+    using Open = int (*) (const char*, int, ...);
+    using OpenAt = int (*) (int, const char*, int, ...);
+    using Close = int (*) (int);
+    using NanoSleep = int (*) (const struct timespec*, struct timespec*);
+    using MicroSleep = int (*) (useconds_t);
+
+    MutexLock nextMutexLock;
+    ConditionWait nextConditionWait;
+    ConditionTimedWait nextConditionTimedWait;
+    Read nextRead;
+    Write nextWrite;
+    Open nextOpen;
+    OpenAt nextOpenAt;
+    Close nextClose;
+    NanoSleep nextNanoSleep;
+    MicroSleep nextMicroSleep;
+
+    /* Looked up before main, while nothing is armed, since dlsym can allocate */
+    struct Initialiser
+    {
+        Initialiser()
+        {
+            nextMutexLock = findNext<MutexLock> ("pthread_mutex_lock");
+            nextConditionWait = findNext<ConditionWait> ("pthread_cond_wait");
+            nextConditionTimedWait = findNext<ConditionTimedWait> ("pthread_cond_timedwait");
+            nextRead = findNext<Read> ("read");
+            nextWrite = findNext<Write> ("write");
+            nextOpen = findNext<Open> ("open");
+            nextOpenAt = findNext<OpenAt> ("openat");
+            nextClose = findNext<Close> ("close");
+            nextNanoSleep = findNext<NanoSleep> ("nanosleep");
+            nextMicroSleep = findNext<MicroSleep> ("usleep");
+
+            if (const char* mode = getenv ("CHAORUSFLANGOS_REALTIME_CHECKS_MODE")) {
+                abortOnViolation = strcmp (mode, "log") != 0;
+            }
+
+            /* The first backtrace loads the unwinder, which allocates */
+            void* frames[4];
+            backtrace (frames, 4);
+        }
+
+        ~Initialiser()
+        {
+            if (numViolations > 0) {
+                char message[96];
+                snprintf (message, sizeof (message), "%d real-time safety violations\n", numViolations.load());
+                writeError (message);
+            }
+        }
+    };
+
+    Initialiser initialiser;
+}
+
+//==============================================================================
+namespace chaorus
+{
+    void enterRealtimeSection() noexcept
+    {
+        realtimeDepth++;
+    }
+
+    void exitRealtimeSection() noexcept
+    {
+        realtimeDepth--;
+    }
+}
+
+//==============================================================================
+extern "C"
+{
+    void* malloc (size_t size)
+    {
+        violation ("malloc");
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        violation ("calloc");
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* pointer, size_t size)
+    {
+        violation ("realloc");
+        return __libc_realloc (pointer, size);
+    }
+
+    void free (void* pointer)
+    {
+        if (pointer != nullptr) {
+            violation ("free");
+        }
+        __libc_free (pointer);
+    }
+
+    int posix_memalign (void** pointer, size_t alignment, size_t size)
+    {
+        violation ("posix_memalign");
+        *pointer = __libc_memalign (alignment, size);
+        return *pointer != nullptr ? 0 : ENOMEM;
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size)
+    {
+        violation ("aligned_alloc");
+        return __libc_memalign (alignment, size);
+    }
+
+    void* memalign (size_t alignment, size_t size)
+    {
+        violation ("memalign");
+        return __libc_memalign (alignment, size);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        violation ("pthread_mutex_lock");
+        return nextMutexLock (mutex);
+    }
+
+    int pthread_cond_wait (pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        violation ("pthread_cond_wait");
+        return nextConditionWait (condition, mutex);
+    }
+
+    int pthread_cond_timedwait (pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* time)
+    {
+        violation ("pthread_cond_timedwait");
+        return nextConditionTimedWait (condition, mutex, time);
+    }
+
+    ssize_t read (int file, void* buffer, size_t size)
+    {
+        violation ("read");
+        return nextRead (file, buffer, size);
+    }
+
+    ssize_t write (int file, const void* buffer, size_t size)
+    {
+        violation ("write");
+        return nextWrite (file, buffer, size);
+    }
+
+    int open (const char* path, int flags, ...)
+    {
+        violation ("open");
+
+        va_list arguments;
+        va_start (arguments, flags);
+        const mode_t mode = (flags & (O_CREAT | O_TMPFILE)) != 0 ? (mode_t) va_arg (arguments, int) : 0;
+        va_end (arguments);
+
+        return nextOpen (path, flags, mode);
+    }
+
+    int openat (int directory, const char* path, int flags, ...)
+    {
+        violation ("openat");
+
+        va_list arguments;
+        va_start (arguments, flags);
+        const mode_t mode = (flags & (O_CREAT | O_TMPFILE)) != 0 ? (mode_t) va_arg (arguments, int) : 0;
+        va_end (arguments);
+
+        return nextOpenAt (directory, path, flags, mode);
+    }
+
+    int close (int file)
+    {
+        violation ("close");
+        return nextClose (file);
+    }
+
+    int nanosleep (const struct timespec* duration, struct timespec* remaining)
+    {
+        violation ("nanosleep");
+        return nextNanoSleep (duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        violation ("usleep");
+        return nextMicroSleep (microseconds);
+    }
+}
+
+//==============================================================================
+void* operator new (size_t size)
+{
+    violation ("operator new");
+
+    if (void* pointer = __libc_malloc (size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size)
+{
+    violation ("operator new[]");
+
+    if (void* pointer = __libc_malloc (size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept
+{
+    violation ("operator new");
+    return __libc_malloc (size == 0 ? 1 : size);
+}
+
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept
+{
+    violation ("operator new[]");
+    return __libc_malloc (size == 0 ? 1 : size);
+}
+
+void* operator new (size_t size, std::align_val_t alignment)
+{
+    violation ("operator new");
+
+    if (void* pointer = __libc_memalign ((size_t) alignment, size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[] (size_t size, std::align_val_t alignment)
+{
+    violation ("operator new[]");
+
+    if (void* pointer = __libc_memalign ((size_t) alignment, size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete (void* pointer) noexcept
+{
+    if (pointer != nullptr) {
+        violation ("operator delete");
+    }
+    __libc_free (pointer);
+}
+
+void operator delete[] (void* pointer) noexcept
+{
+    if (pointer != nullptr) {
+        violation ("operator delete[]");
+    }
+    __libc_free (pointer);
+}
+
+void operator delete (void* pointer, size_t) noexcept                          { operator delete (pointer); }
+void operator delete[] (void* pointer, size_t) noexcept                        { operator delete[] (pointer); }
+void operator delete (void* pointer, std::align_val_t) noexcept                { operator delete (pointer); }
+void operator delete[] (void* pointer, std::align_val_t) noexcept              { operator delete[] (pointer); }
+void operator delete (void* pointer, size_t, std::align_val_t) noexcept        { operator delete (pointer); }
+void operator delete[] (void* pointer, size_t, std::align_val_t) noexcept      { operator delete[] (pointer); }
@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+
+    SegmentedRenderCheck.cpp
+
+    Checks that rendering an input in segments, each on its own engine with
+    pre-roll, puts out what rendering it serially does. Every segment is
+    rendered the way SegmentedRenderer::renderRange() renders it: a fresh
+    engine sought to the quantum on or before the segment's start less the
+    pre-roll chaorus::getPreRollSamples() asks for at the renderer's default
+    floor, run from there in host sized blocks, and only the segment kept.
+    The same input also goes through one engine from sample 0.
+
+    For a few modes, feedback amounts, delay ranges, sample rates and block
+    sizes it prints the largest difference between the two within the
+    renderer's default seam check length of each seam, and anywhere. It exits
+    with 1 if either goes above the renderer's default seam tolerance.
+
+    SegmentedRenderer's own seam check only compares against a render with
+    twice the pre-roll, which can't catch pre-roll that is too short by a
+    constant factor. This compares against the real serial render.
+
+    Needs no JUCE, build it with
+
+        c++ -std=c++17 -O2 -I../Source SegmentedRenderCheck.cpp -o SegmentedRenderCheck
+
+    and run it from anywhere.
+
+  ==============================================================================
+*/
+
+#include "ChaorusCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    /* SegmentedRenderer::Options defaults */
+    constexpr float preRollFloorDb = -96.0f;
+    constexpr int seamCheckLength = 4096;
+    constexpr float seamToleranceDb = -80.0f;
+
+    constexpr int numChannels = 2;
+    constexpr int numSegments = 4;
+
+    struct Case
+    {
+        const char* name;
+        double sampleRate;
+        int blockSize;
+        chaorus::Parameters parameters;
+    };
+
+    std::vector<Case> getCases()
+    {
+        std::vector<Case> cases;
+
+        auto add = [&] (const char* name, double sampleRate, int blockSize, int type, float feedback) -> chaorus::Parameters& {
+            Case c { name, sampleRate, blockSize, {} };
+            c.parameters.type = type;
+            c.parameters.feedback = feedback;
+            cases.push_back (c);
+            return cases.back().parameters;
+        };
+
+        add ("Jello", 48000.0, 512, chaorus::Jello, 0.5f);
+        add ("Jello, no feedback", 96000.0, 512, chaorus::Jello, 0.0f);
+        add ("Jello, 100 sample blocks", 44100.0, 100, chaorus::Jello, 0.5f);
+        add ("Wavy, high feedback", 44100.0, 512, chaorus::Wavy, 0.7f);
+        add ("Tormentrix", 48000.0, 512, chaorus::Tormentrix, 0.5f).distortion = 0.5f;
+        add ("Dual, parallel", 48000.0, 512, chaorus::Dual, 0.5f);
+        add ("Dual, serial", 48000.0, 512, chaorus::Dual, 0.5f).routing = chaorus::Serial;
+
+        chaorus::Parameters& slapback = add ("Jello, 1 s base delay", 48000.0, 512, chaorus::Jello, 0.5f);
+        slapback.baseDelay = 1.0f;
+        slapback.delayRange = 0.5f;
+
+        return cases;
+    }
+
+    /* Noise plus a sine, deterministic, so every delay reads something different */
+    std::vector<float> makeInput (int64_t numSamples, int channel)
+    {
+        std::vector<float> input ((size_t) numSamples);
+        uint32_t seed = 12345u + (uint32_t) channel;
+
+        for (int64_t i = 0; i < numSamples; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            const float noise = (float) (seed >> 8) / (float) (1u << 24) - 0.5f;
+            input[(size_t) i] = 0.25f * noise + 0.25f * (float) std::sin (0.003 * (double) i);
+        }
+
+        return input;
+    }
+
+    /* An engine prepared the way the processor prepares its own, for the delay range in use */
+    struct Engine
+    {
+        Engine (double sampleRate, const chaorus::Parameters& parameters)
+        {
+            const double delayTime = chaorus::getDelayMemoryTime (parameters);
+
+            delayMemory = chaorus::makeDelayMemory (chaorus::getCircularBufferSize (sampleRate, false, delayTime));
+            chaorus::prepare (state, sampleRate, delayMemory.get(), false, delayTime);
+        }
+
+        chaorus::State state;
+        chaorus::DelayMemoryPtr delayMemory;
+    };
+
+    /* Runs input[start, end) through the engine in blocks of blockSize, calling keep with each
+       processed block and its position */
+    template <typename Keep>
+    void run (Engine& engine, const Case& c, const std::vector<float> (&input)[numChannels],
+              int64_t start, int64_t end, Keep&& keep)
+    {
+        std::vector<float> block[numChannels];
+
+        for (auto& channel : block) {
+            channel.resize ((size_t) c.blockSize);
+        }
+
+        for (int64_t position = start; position < end; position += c.blockSize) {
+            const int numSamples = (int) std::min ((int64_t) c.blockSize, end - position);
+            float* channels[numChannels];
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                std::copy_n (input[channel].begin() + position, numSamples, block[channel].begin());
+                channels[channel] = block[channel].data();
+            }
+
+            chaorus::process (engine.state, c.parameters, channels, channels, numChannels, numSamples);
+
+            keep (position, numSamples, channels);
+        }
+    }
+
+    struct Errors
+    {
+        float seams = 0.0f;
+        float anywhere = 0.0f;
+    };
+
+    Errors check (const Case& c, int& preRollSamples)
+    {
+        preRollSamples = chaorus::getPreRollSamples (c.parameters, c.sampleRate, preRollFloorDb);
+
+        /* Long enough for SegmentedRenderer not to cut down the number of segments */
+        const int64_t length = (int64_t) numSegments * preRollSamples + 12345;
+        const int64_t segmentLength = (length + numSegments - 1) / numSegments;
+
+        const std::vector<float> input[numChannels] = { makeInput (length, 0), makeInput (length, 1) };
+        std::vector<float> serial[numChannels] = { std::vector<float> ((size_t) length), std::vector<float> ((size_t) length) };
+
+        {
+            Engine engine (c.sampleRate, c.parameters);
+
+            run (engine, c, input, 0, length, [&] (int64_t position, int numSamples, float* const* channels) {
+                for (int channel = 0; channel < numChannels; channel++) {
+                    std::copy_n (channels[channel], numSamples, serial[channel].begin() + position);
+                }
+            });
+        }
+
+        Errors errors;
+
+        for (int segment = 0; segment < numSegments; segment++) {
+            const int64_t segmentStart = segment * segmentLength;
+            const int64_t segmentEnd = std::min (length, segmentStart + segmentLength);
+
+            int64_t warmUpStart = std::max ((int64_t) 0, segmentStart - preRollSamples);
+            warmUpStart -= warmUpStart % chaorus::processingQuantum;
+
+            Engine engine (c.sampleRate, c.parameters);
+            chaorus::seek (engine.state, c.parameters, warmUpStart);
+
+            run (engine, c, input, warmUpStart, segmentEnd, [&] (int64_t position, int numSamples, float* const* channels) {
+                for (int64_t i = std::max (position, segmentStart); i < position + numSamples; i++) {
+                    const bool nearSeam = segment > 0 && i < segmentStart + seamCheckLength;
+                    const bool nearNextSeam = segment < numSegments - 1 && i >= segmentEnd - seamCheckLength;
+
+                    for (int channel = 0; channel < numChannels; channel++) {
+                        const float error = std::abs (channels[channel][i - position] - serial[channel][(size_t) i]);
+
+                        errors.anywhere = std::max (errors.anywhere, error);
+
+                        if (nearSeam || nearNextSeam) {
+                            errors.seams = std::max (errors.seams, error);
+                        }
+                    }
+                }
+            });
+        }
+
+        return errors;
+    }
+
+    float toDecibels (float gain)
+    {
+        return gain > 0.0f ? 20.0f * std::log10 (gain) : -200.0f;
+    }
+}
+
+int main()
+{
+    bool passed = true;
+
+    std::printf ("%-26s %8s %6s %10s %12s %12s\n", "case", "rate", "block", "pre-roll", "seams dB", "anywhere dB");
+
+    for (const Case& c : getCases()) {
+        int preRollSamples = 0;
+        const Errors errors = check (c, preRollSamples);
+        const float seamsDb = toDecibels (errors.seams);
+        const float anywhereDb = toDecibels (errors.anywhere);
+        const bool withinTolerance = seamsDb <= seamToleranceDb && anywhereDb <= seamToleranceDb;
+
+        passed = passed && withinTolerance;
+
+        std::printf ("%-26s %8.0f %6d %10d %12.1f %12.1f%s\n", c.name, c.sampleRate, c.blockSize, preRollSamples,
+                     seamsDb, anywhereDb, withinTolerance ? "" : "  above tolerance");
+    }
+
+    std::printf ("tolerance %.1f dB\n", seamToleranceDb);
+
+    return passed ? 0 : 1;
+}